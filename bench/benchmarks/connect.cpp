@@ -0,0 +1,36 @@
+#include "benchmark/benchmark.h"
+#include "socket/socket.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// Connects to 64 peers, one after another with Bidirectional or all at once with connect_many.
+// The listener drains its backlog inside the loop for both.
+template <bool parallel>
+static void BM_FanOut(benchmark::State& state) {
+  const size_t n_connections = 64;
+  Listening s(PORT);
+  std::vector<Address> addresses(n_connections, s.get_address());
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<Bidirectional>> connections;
+    if (parallel) {
+      for (auto& result : connect_many(addresses))
+        connections.push_back(std::move(result.connection));
+    } else {
+      for (auto& address : addresses)
+        connections.push_back(std::make_unique<Bidirectional>(address));
+    }
+    size_t accepted = 0;
+    while (accepted < n_connections)
+      accepted += s.accept_batch(n_connections).size();
+  }
+  state.SetItemsProcessed(state.iterations() * n_connections);
+}
+// Bounded so that sockets left in TIME_WAIT do not exhaust the ephemeral ports.
+BENCHMARK_TEMPLATE(BM_FanOut, false)->UseRealTime()->Iterations(200);
+BENCHMARK_TEMPLATE(BM_FanOut, true)->UseRealTime()->Iterations(200);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,65 @@
+#include <atomic>
+#include <future>
+
+#include "benchmark/benchmark.h"
+#include "socket/connection_pool.hpp"
+#include "socket/reactor.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// One 4-byte request and response per iteration against an echo server, connecting a new
+// socket every time or leasing one from a ConnectionPool.
+template <bool pooled>
+static void BM_Request(benchmark::State& state) {
+  Listening s(PORT);
+  std::atomic<bool> stop(false);
+  std::future<void> serverF = std::async(std::launch::async, [&s, &stop] (void) {
+        Reactor r;
+        std::unordered_map<Bidirectional*, std::unique_ptr<Bidirectional>> connections;
+        r.add(s, Reactor::Handlers{[&] (void) {
+              for (auto& accepted : s.accept_batch(64, 0)) {
+                Bidirectional* b = accepted.get();
+                connections.emplace(b, std::move(accepted));
+                r.add(*b, Reactor::Handlers{[&r, &connections, b] (void) {
+                      uint32_t message;
+                      try {
+                        b->read(&message, sizeof(uint32_t));
+                        b->write(&message, sizeof(uint32_t));
+                      } catch (const std::system_error&) { // closed by the client
+                        r.remove(*b);
+                        connections.erase(b);
+                      }
+                    }});
+              }
+            }});
+        while (!stop)
+          r.poll(10);
+        for (auto& c : connections)
+          r.remove(*c.second);
+      });
+  ConnectionPool p;
+  uint32_t message = 0;
+  for (auto _ : state) {
+    if (pooled) {
+      ConnectionPool::Lease l(p.acquire(s.get_address()));
+      l->write(&message, sizeof(uint32_t));
+      l->read(&message, sizeof(uint32_t));
+    } else {
+      Bidirectional b(s.get_address());
+      b.write(&message, sizeof(uint32_t));
+      b.read(&message, sizeof(uint32_t));
+    }
+  }
+  stop = true;
+  serverF.get();
+  state.SetItemsProcessed(state.iterations());
+}
+// Bounded so that sockets left in TIME_WAIT do not exhaust the ephemeral ports.
+BENCHMARK_TEMPLATE(BM_Request, false)->UseRealTime()->Iterations(5000);
+BENCHMARK_TEMPLATE(BM_Request, true)->UseRealTime()->Iterations(5000);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,29 @@
+#include "benchmark/benchmark.h"
+#include "socket/connection_slab.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// A connection is opened, accepted and closed on every iteration, the accepted socket coming
+// from the heap through Listening::accept or from a ConnectionSlab.
+template <bool slab>
+static void BM_AcceptClose(benchmark::State& state) {
+  Listening s(PORT);
+  ConnectionSlab connections(16);
+  for (auto _ : state) {
+    Connected c(s.get_address());
+    if (slab)
+      benchmark::DoNotOptimize(connections.accept(s, -1));
+    else
+      benchmark::DoNotOptimize(s.accept(-1));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+// Bounded so that sockets left in TIME_WAIT do not exhaust the ephemeral ports.
+BENCHMARK_TEMPLATE(BM_AcceptClose, false)->Iterations(5000);
+BENCHMARK_TEMPLATE(BM_AcceptClose, true)->Iterations(5000);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,33 @@
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "socket/datagram.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// 64-byte datagrams sent and received in batches of state.range(0), one sendmmsg and usually
+// one recvmmsg per batch.
+static void BM_DatagramBatch(benchmark::State& state) {
+  const size_t message_size = 64;
+  const size_t batch = state.range(0);
+  Datagram in, out;
+  std::vector<char> buf(batch * message_size, 'a');
+  std::vector<Datagram::Message> sent(batch), received(batch);
+  for (size_t i = 0; i < batch; i++)
+    sent[i] = Datagram::Message{&buf[i * message_size], message_size, in.get_address()};
+  for (auto _ : state) {
+    out.send_batch(sent.data(), batch);
+    size_t n = 0;
+    while (n < batch) {
+      for (size_t i = n; i < batch; i++)
+        received[i] = Datagram::Message{&buf[i * message_size], message_size};
+      n += in.recv_batch(&received[n], batch - n);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_DatagramBatch)->Arg(1)->Arg(8)->Arg(64);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,49 @@
+#include <atomic>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "socket/listening_group.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// Connections accepted per second as the number of SO_REUSEPORT workers grows. Each worker is
+// pinned and drains its own listener; an equal number of threads open connections.
+static void BM_ListeningGroupAccept(benchmark::State& state) {
+  const size_t n_workers = state.range(0);
+  const size_t n_connections = 256; // per iteration
+  ListeningGroup g(PORT, n_workers);
+  std::atomic<bool> running(true);
+  std::atomic<size_t> accepted(0);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < n_workers; i++)
+    workers.emplace_back([&g, &running, &accepted, i] (void) {
+          g.pin(i);
+          while (running)
+            accepted += g[i].accept_batch(64, 10).size();
+        });
+  size_t total = 0;
+  for (auto _ : state) {
+    std::vector<std::thread> connectors;
+    for (size_t i = 0; i < n_workers; i++)
+      connectors.emplace_back([&g, n_connections, n_workers] (void) {
+            for (size_t n = 0; n < n_connections / n_workers; n++)
+              Connected c(g.get_address());
+          });
+    for (auto& c : connectors)
+      c.join();
+    total += n_connections / n_workers * n_workers;
+    while (accepted < total)
+      std::this_thread::yield();
+  }
+  running = false;
+  for (auto& w : workers)
+    w.join();
+  state.counters["connections/s"] = benchmark::Counter(total, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ListeningGroupAccept)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
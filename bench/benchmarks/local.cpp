@@ -0,0 +1,70 @@
+#include <future>
+
+#include "benchmark/benchmark.h"
+#include "socket/socket.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+static Address get_bind_address(bool local) {
+  return local ? Address::local_abstract("socket-bench") : Address("127.0.0.1", PORT);
+}
+
+// Round trips of a small message over TCP loopback or an AF_UNIX stream socket.
+template <bool local>
+static void BM_LocalPingPong(benchmark::State& state) {
+  const size_t message_size = 64;
+  Listening s(get_bind_address(local));
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  auto in = std::make_unique<Bidirectional>(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> echoF = std::async(std::launch::async, [&out, message_size] (void) {
+        char message[message_size];
+        try {
+          while (true) {
+            out->read(message, message_size);
+            out->write(message, message_size);
+          }
+        } catch (std::system_error&) {} // closed by the client
+      });
+  char message[message_size] = {};
+  for (auto _ : state) {
+    in->write(message, message_size);
+    in->read(message, message_size);
+  }
+  in.reset();
+  echoF.get();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_LocalPingPong, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LocalPingPong, true)->UseRealTime();
+
+// One-way throughput of 64 KiB writes over TCP loopback or an AF_UNIX stream socket.
+template <bool local>
+static void BM_LocalStream(benchmark::State& state) {
+  const size_t message_size = 65536;
+  Listening s(get_bind_address(local));
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> readF = std::async(std::launch::async, [&in, message_size] (void) {
+        std::vector<char> message(message_size);
+        try {
+          while (true)
+            in.read(message.data(), message_size);
+        } catch (std::system_error&) {} // closed by the writer
+      });
+  std::vector<char> message(message_size);
+  for (auto _ : state)
+    out->write(message.data(), message_size);
+  out.reset();
+  readF.get();
+  state.SetBytesProcessed(state.iterations() * message_size);
+}
+BENCHMARK_TEMPLATE(BM_LocalStream, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LocalStream, true)->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "socket/reactor.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// Round trips of one message to an echo thread. Besides the mean, reports the latency
+// percentiles of the individual round trips in microseconds.
+static void BM_PingPong(benchmark::State& state) {
+  const size_t message_size = state.range(0);
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  auto in = std::make_unique<Bidirectional>(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> echoF = std::async(std::launch::async, [&out, message_size] (void) {
+        std::vector<char> message(message_size);
+        try {
+          while (true) {
+            out->read(message.data(), message_size);
+            out->write(message.data(), message_size);
+          }
+        } catch (std::system_error&) {} // closed by the client
+      });
+  std::vector<char> message(message_size);
+  std::vector<double> round_trips;
+  round_trips.reserve(state.max_iterations);
+  for (auto _ : state) {
+    auto start = std::chrono::steady_clock::now();
+    in->write(message.data(), message_size);
+    in->read(message.data(), message_size);
+    round_trips.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - start).count());
+  }
+  in.reset();
+  echoF.get();
+  std::sort(round_trips.begin(), round_trips.end());
+  for (auto p : {std::make_pair("p50_us", 0.5), std::make_pair("p99_us", 0.99),
+      std::make_pair("p999_us", 0.999)})
+    state.counters[p.first] = round_trips[size_t(p.second * (round_trips.size() - 1))];
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PingPong)->Arg(16)->Arg(1024)->Arg(16384)->UseRealTime();
+
+// One-way streaming throughput for different write sizes. A reader thread consumes whole writes
+// until the writer closes the connection.
+static void BM_Stream(benchmark::State& state) {
+  const size_t message_size = state.range(0);
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> readF = std::async(std::launch::async, [&in, message_size] (void) {
+        std::vector<char> message(message_size);
+        try {
+          while (true)
+            in.read(message.data(), message_size);
+        } catch (std::system_error&) {} // closed by the writer
+      });
+  std::vector<char> message(message_size);
+  for (auto _ : state)
+    out->write(message.data(), message_size);
+  out.reset();
+  readF.get();
+  state.SetBytesProcessed(state.iterations() * message_size);
+}
+BENCHMARK(BM_Stream)->RangeMultiplier(16)->Range(64, 1 << 20)->UseRealTime();
+
+// Connections accepted per second by one listener while several threads connect at once. The
+// argument is the number of connecting threads.
+static void BM_AcceptRate(benchmark::State& state) {
+  const size_t n_connectors = state.range(0);
+  const size_t n_connections = 256; // per iteration
+  Listening s(PORT);
+  for (auto _ : state) {
+    std::vector<std::thread> connectors;
+    for (size_t i = 0; i < n_connectors; i++)
+      connectors.emplace_back([&s, n_connections, n_connectors] (void) {
+            for (size_t n = 0; n < n_connections / n_connectors; n++)
+              Connected c(s.get_address());
+          });
+    size_t accepted = 0;
+    while (accepted < n_connections / n_connectors * n_connectors)
+      accepted += s.accept_batch(64, 10).size();
+    for (auto& c : connectors)
+      c.join();
+  }
+  state.counters["connections/s"] = benchmark::Counter(
+      state.iterations() * (n_connections / n_connectors * n_connectors),
+      benchmark::Counter::kIsRate);
+}
+// Bounded so that sockets left in TIME_WAIT do not exhaust the ephemeral ports.
+BENCHMARK(BM_AcceptRate)->Arg(1)->Arg(4)->Arg(16)->UseRealTime()->Iterations(20);
+
+// Many clients each send one small message per iteration, and a Reactor on the server side
+// collects them all. The argument is the number of connections.
+static void BM_FanIn(benchmark::State& state) {
+  const size_t n_connections = state.range(0);
+  const size_t message_size = 16;
+  Listening s(PORT);
+  std::vector<std::unique_ptr<Bidirectional>> clients;
+  for (size_t i = 0; i < n_connections; i++)
+    clients.push_back(std::make_unique<Bidirectional>(s.get_address()));
+  std::vector<std::unique_ptr<Bidirectional>> servers;
+  while (servers.size() < n_connections)
+    for (auto& c : s.accept_batch(n_connections - servers.size()))
+      servers.push_back(std::move(c));
+  Reactor r;
+  size_t received = 0;
+  char message[message_size] = {};
+  for (auto& c : servers) {
+    Bidirectional* server = c.get();
+    r.add(*server, {[server, &message, &received] (void) {
+          server->read(message, message_size);
+          received++;
+        }, nullptr, nullptr});
+  }
+  for (auto _ : state) {
+    for (auto& c : clients)
+      c->write(message, message_size);
+    received = 0;
+    while (received < n_connections)
+      r.poll();
+  }
+  for (auto& c : servers)
+    r.remove(*c);
+  state.SetItemsProcessed(state.iterations() * n_connections);
+}
+BENCHMARK(BM_FanIn)->RangeMultiplier(4)->Range(16, 256)->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
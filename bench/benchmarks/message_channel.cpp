@@ -0,0 +1,43 @@
+#include <future>
+
+#include "benchmark/benchmark.h"
+#include "socket/message_channel.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// 64-byte frames sent and received one at a time, either by hand with a write for the length
+// and one for the payload read into a fresh vector, or through MessageChannel.
+template <bool channel>
+static void BM_Frame(benchmark::State& state) {
+  const uint32_t message_size = 64;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferPool p;
+  MessageChannel sender(in, p), receiver(*out, p);
+  char message[message_size] = {};
+  for (auto _ : state) {
+    if (channel) {
+      sender.send(message, message_size);
+      benchmark::DoNotOptimize(receiver.receive());
+    } else {
+      uint32_t header = htonl(message_size);
+      in.write(&header, sizeof(uint32_t));
+      in.write(message, message_size);
+      out->read(&header, sizeof(uint32_t));
+      std::vector<char> received(ntohl(header));
+      out->read(received.data(), received.size());
+      benchmark::DoNotOptimize(received.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Frame, false);
+BENCHMARK_TEMPLATE(BM_Frame, true);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,69 @@
+#include <future>
+
+#include "benchmark/benchmark.h"
+#include "socket/buffered_connection.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// Small fixed-size messages read one at a time, as a framed protocol reads its headers. The
+// argument is the timeout passed to every read. Built with SOCKET_STATS it also reports the
+// system calls each read makes.
+static void BM_ReadSmall(benchmark::State& state) {
+  const int timeout_ms = state.range(0);
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t message = 0;
+  SocketCounters before = in.get_counters();
+  for (auto _ : state) {
+    out->write(&message, sizeof(uint32_t));
+    if (!in.read(&message, sizeof(uint32_t), timeout_ms))
+      state.SkipWithError("read timed out");
+  }
+  state.SetItemsProcessed(state.iterations());
+#ifdef SOCKET_STATS
+  // Every recv that returned data or EAGAIN, and the poll that follows each EAGAIN, which the
+  // counters do not track themselves.
+  SocketCounters after = in.get_counters();
+  uint64_t syscalls = after.read_calls - before.read_calls +
+      2 * (after.would_block - before.would_block);
+  state.counters["syscalls/msg"] = benchmark::Counter(syscalls,
+      benchmark::Counter::kAvgIterations);
+#else
+  (void) before;
+#endif
+}
+BENCHMARK(BM_ReadSmall)->Arg(-1)->Arg(0)->Arg(1000);
+
+// A burst of small messages arrives at once and is read one message at a time, either straight
+// from the socket or through a BufferedConnection.
+template <bool buffered>
+static void BM_ReadBurst(benchmark::State& state) {
+  const size_t burst = 64;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferedConnection b(in);
+  std::vector<uint32_t> messages(burst);
+  for (auto _ : state) {
+    out->write(messages.data(), messages.size() * sizeof(uint32_t));
+    for (size_t i = 0; i < burst; i++) {
+      uint32_t message;
+      if (buffered)
+        b.read_exact(&message, sizeof(uint32_t));
+      else
+        in.read(&message, sizeof(uint32_t));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * burst);
+}
+BENCHMARK_TEMPLATE(BM_ReadBurst, false);
+BENCHMARK_TEMPLATE(BM_ReadBurst, true);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,60 @@
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "socket/buffered_connection.hpp"
+#include "socket/send_queue.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// Several threads reply on one connection, either serialized by a mutex around write or through
+// a SendQueue. The argument is the number of writing threads.
+template <bool queue>
+static void BM_SharedWriters(benchmark::State& state) {
+  const size_t n_threads = state.range(0);
+  const size_t n_messages = 1000; // per thread and iteration
+  const size_t message_size = 64;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> readF = std::async(std::launch::async, [&in, message_size] (void) {
+        BufferedConnection b(in);
+        char message[message_size];
+        try {
+          while (true)
+            b.read_exact(message, message_size);
+        } catch (std::system_error&) {} // closed by the writers
+      });
+  SendQueue q(*out);
+  std::mutex mutex;
+  for (auto _ : state) {
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < n_threads; t++)
+      writers.emplace_back([&] (void) {
+            char message[message_size] = {};
+            for (size_t i = 0; i < n_messages; i++) {
+              if (queue) {
+                q.send(message, message_size);
+              } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                out->write(message, message_size);
+              }
+            }
+          });
+    for (auto& w : writers)
+      w.join();
+  }
+  out.reset();
+  readF.get();
+  state.SetItemsProcessed(state.iterations() * n_threads * n_messages);
+}
+BENCHMARK_TEMPLATE(BM_SharedWriters, false)->Arg(1)->Arg(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SharedWriters, true)->Arg(1)->Arg(4)->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+#include "benchmark/benchmark.h"
+#include "socket/server.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// Replies to every 16 byte request with the request, after spinning for the given microseconds.
+static Server::Handler get_handler(std::chrono::microseconds work) {
+  return [work] (const char* data, size_t size, std::string& response) -> size_t {
+    const size_t message_size = 16;
+    if (work.count() > 0) {
+      auto end = std::chrono::steady_clock::now() + work;
+      while (std::chrono::steady_clock::now() < end) {}
+    }
+    size_t n = size / message_size * message_size;
+    response.append(data, n);
+    return n;
+  };
+}
+
+static ServerConfig get_config(size_t threads) {
+  ServerConfig config;
+  config.workers = threads;
+  config.pool_threads = threads;
+  return config;
+}
+
+// Connections per second through connect, one request and close. The argument is the number of
+// workers and pool threads.
+static void BM_ServerConnect(benchmark::State& state) {
+  const size_t message_size = 16;
+  Server server(Address("127.0.0.1", PORT), get_handler(std::chrono::microseconds(0)),
+      get_config(state.range(0)));
+  char message[message_size] = {};
+  for (auto _ : state) {
+    Bidirectional client(server.get_address());
+    client.write(message, message_size);
+    client.read(message, message_size);
+  }
+  state.counters["connections/s"] = benchmark::Counter(state.iterations(),
+      benchmark::Counter::kIsRate);
+}
+// Bounded so that sockets left in TIME_WAIT do not exhaust the ephemeral ports.
+BENCHMARK(BM_ServerConnect)->Arg(1)->Arg(2)->Arg(4)->UseRealTime()->Iterations(2000);
+
+// 64 clients on 8 threads each make a batch of round trips per iteration. The arguments are the
+// number of workers and pool threads and the handler's work per request in microseconds; reports
+// the percentiles of the individual round trips in microseconds.
+static void BM_ServerPingPong(benchmark::State& state) {
+  const size_t message_size = 16;
+  const size_t n_threads = 8;
+  const size_t n_clients = 64;
+  const size_t rounds = 16;
+  Server server(Address("127.0.0.1", PORT),
+      get_handler(std::chrono::microseconds(state.range(1))), get_config(state.range(0)));
+  std::vector<std::unique_ptr<Bidirectional>> clients;
+  for (size_t i = 0; i < n_clients; i++)
+    clients.push_back(std::make_unique<Bidirectional>(server.get_address()));
+  std::vector<std::vector<double>> round_trips(n_threads);
+  for (auto _ : state) {
+    std::vector<std::future<void>> threads;
+    for (size_t t = 0; t < n_threads; t++)
+      threads.push_back(std::async(std::launch::async, [&, t] (void) {
+            char message[message_size] = {};
+            for (size_t round = 0; round < rounds; round++) {
+              for (size_t i = t; i < n_clients; i += n_threads) {
+                auto start = std::chrono::steady_clock::now();
+                clients[i]->write(message, message_size);
+                clients[i]->read(message, message_size);
+                round_trips[t].push_back(std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start).count());
+              }
+            }
+          }));
+    for (auto& thread : threads)
+      thread.get();
+  }
+  std::vector<double> all;
+  for (auto& r : round_trips)
+    all.insert(all.end(), r.begin(), r.end());
+  std::sort(all.begin(), all.end());
+  for (auto p : {std::make_pair("p50_us", 0.5), std::make_pair("p99_us", 0.99)})
+    state.counters[p.first] = all[size_t(p.second * (all.size() - 1))];
+  state.SetItemsProcessed(all.size());
+}
+BENCHMARK(BM_ServerPingPong)->Args({1, 0})->Args({2, 0})->Args({4, 0})->Args({1, 50})
+    ->Args({4, 50})->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
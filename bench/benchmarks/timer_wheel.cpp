@@ -0,0 +1,28 @@
+#include "benchmark/benchmark.h"
+#include "socket/timer_wheel.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// Pushing back the idle deadline of one connection among many, as every read does. The argument
+// is the number of armed timers; the cost per reset should not depend on it.
+static void BM_TimerReset(benchmark::State& state) {
+  const size_t n_timers = state.range(0);
+  Reactor r;
+  TimerWheel w(r);
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  for (size_t i = 0; i < n_timers; i++) {
+    timers.push_back(std::make_unique<TimerWheel::Timer>([] (void) {}));
+    w.arm(*timers.back(), std::chrono::seconds(30));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    w.arm(*timers[i], std::chrono::milliseconds(30000 - i % 1000));
+    i = (i + 1) % n_timers;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimerReset)->RangeMultiplier(10)->Range(100, 100000);
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,52 @@
+#include "socket/tls.hpp"
+
+#ifdef SOCKET_HAVE_TLS
+#include <future>
+
+#include "benchmark/benchmark.h"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// One-way throughput of 64 KiB writes over TCP loopback, in the clear or encrypted by kernel TLS.
+template <bool tls>
+static void BM_TlsStream(benchmark::State& state) {
+  const size_t message_size = 65536;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(Address("127.0.0.1", PORT));
+  std::unique_ptr<Bidirectional> out = outF.get();
+  if (tls) {
+    TlsContext server = TlsContext::self_signed("localhost");
+    TlsContext client = TlsContext::client("", false);
+    std::future<void> accepted = std::async([&] { server.handshake(*out); });
+    try {
+      client.handshake(in);
+      accepted.get();
+    } catch (const std::system_error&) {
+      state.SkipWithError("kernel TLS is not available");
+      return;
+    }
+  }
+  std::future<void> readF = std::async(std::launch::async, [&in, message_size] (void) {
+        std::vector<char> message(message_size);
+        try {
+          while (true)
+            in.read(message.data(), message_size);
+        } catch (std::system_error&) {} // closed by the writer
+      });
+  std::vector<char> message(message_size);
+  for (auto _ : state)
+    out->write(message.data(), message_size);
+  out.reset();
+  readF.get();
+  state.SetBytesProcessed(state.iterations() * message_size);
+}
+BENCHMARK_TEMPLATE(BM_TlsStream, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TlsStream, true)->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -0,0 +1,49 @@
+#include <cstring>
+#include <future>
+
+#include "benchmark/benchmark.h"
+#include "socket/batched_writer.hpp"
+#include "socket/buffered_connection.hpp"
+
+#define PORT 9999
+
+namespace wrapper {
+namespace socket {
+
+// 16-byte messages written one at a time, either straight to the socket or through a
+// BatchedWriter. A reader thread drains the other end until it sees the terminating message.
+template <bool coalesce>
+static void BM_WriteSmall(benchmark::State& state) {
+  const size_t message_size = 16;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> readF = std::async(std::launch::async, [&in, message_size] (void) {
+        BufferedConnection b(in);
+        char message[message_size];
+        do {
+          b.read_exact(message, message_size);
+        } while (message[0] != 'x');
+      });
+  BatchedWriter w(*out);
+  char message[message_size];
+  std::memset(message, 'a', message_size);
+  for (auto _ : state) {
+    if (coalesce)
+      w.write(message, message_size);
+    else
+      out->write(message, message_size);
+  }
+  std::memset(message, 'x', message_size);
+  w.write(message, message_size);
+  w.flush();
+  readF.get();
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * message_size);
+}
+BENCHMARK_TEMPLATE(BM_WriteSmall, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_WriteSmall, true)->UseRealTime();
+
+} // namespace socket
+} // namespace wrapper
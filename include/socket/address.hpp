@@ -2,20 +2,52 @@
 #define WRAPPER_SOCKET_ADDRESS_HPP
 
 #include <arpa/inet.h>
+#include <functional>
 #include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/un.h>
 #include <utility>
 
 namespace wrapper {
 namespace socket {
 
+// An IPv4 or IPv6 address and port, or a Unix domain socket name, held in binary form. Text is
+// only produced by ip(), path() and operator<<, so copying, comparing and hashing never format or
+// parse.
 class Address {
   protected:
-    char _ip[INET_ADDRSTRLEN];
-    unsigned short _port;
+    // Only the family, port, address and IPv6 scope, or the Unix name, are kept; every other byte
+    // is zero so that two equal addresses are equal byte for byte.
+    union {
+      sockaddr any;
+      sockaddr_in v4;
+      sockaddr_in6 v6;
+      sockaddr_un local;
+    } storage;
+    // AF_UNIX: the bytes of storage.local in use. Abstract names are kept as the kernel gave
+    // them, so they may hold 0 bytes and need not end at the first one.
+    socklen_t local_size;
   public:
+    Address(void); // AF_UNSPEC
     Address(const std::string& ip, unsigned short port);
-    const std::string ip(void) const;
-    const unsigned short port(void) const;
+    Address(const sockaddr_in& addr);
+    Address(const sockaddr_in6& addr);
+    Address(const sockaddr* addr, socklen_t size);
+    // AF_UNIX addresses. An abstract name lives outside the filesystem and disappears with the
+    // socket; an empty one lets the kernel pick a name on bind.
+    static Address local_path(const std::string& path);
+    static Address local_abstract(const std::string& name);
+    const std::string ip(void) const; // empty for AF_UNIX
+    const unsigned short port(void) const; // 0 for AF_UNIX
+    // AF_UNIX only: the path, or the abstract name preceded by '@'. Empty if unnamed.
+    const std::string path(void) const;
+    sa_family_t family(void) const noexcept;
+    bool is_any(void) const noexcept; // 0.0.0.0 or ::
+    // For passing to bind, connect and sendto.
+    const sockaddr* get_sockaddr(void) const noexcept;
+    socklen_t get_sockaddr_size(void) const noexcept;
+    size_t hash(void) const noexcept;
     bool operator==(const Address& o) const;
     bool operator!=(const Address& o) const;
 };
@@ -25,4 +57,9 @@ static_assert(std::is_trivially_copyable<Address>::value);
 
 } // namespace socket
 } // namespace wrapper
+
+template<>
+struct std::hash<wrapper::socket::Address> {
+  size_t operator()(const wrapper::socket::Address& a) const noexcept { return a.hash(); }
+};
 #endif
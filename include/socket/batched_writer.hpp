@@ -0,0 +1,33 @@
+#ifndef WRAPPER_SOCKET_BATCHED_WRITER_HPP
+#define WRAPPER_SOCKET_BATCHED_WRITER_HPP
+
+#include "socket.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// Coalesces small writes to a Bidirectional socket. Writes are copied into a buffer that is sent
+// with a single sendmsg when flush() is called or the threshold is reached. The destructor
+// flushes anything still pending. When a send throws, the bytes that did not go out, including
+// the rest of the data passed to the failing write, stay pending, so a later flush resumes the
+// stream where it broke off.
+class BatchedWriter final {
+  private:
+    Bidirectional& connection;
+    const size_t threshold;
+    std::vector<char> buffer;
+    void send(const iovec* iov, size_t iovcnt);
+  public:
+    BatchedWriter(Bidirectional& connection, size_t threshold=16384);
+    BatchedWriter(BatchedWriter&) = delete;
+    BatchedWriter(const BatchedWriter&) = delete;
+    BatchedWriter(BatchedWriter&& o);
+    ~BatchedWriter(void);
+    void write(const void* buf, size_t count);
+    void flush(void);
+    size_t pending(void) const noexcept;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
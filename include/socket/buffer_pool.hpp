@@ -0,0 +1,52 @@
+#ifndef WRAPPER_SOCKET_BUFFER_POOL_HPP
+#define WRAPPER_SOCKET_BUFFER_POOL_HPP
+
+#include <memory>
+#include <vector>
+
+namespace wrapper {
+namespace socket {
+
+// Hands out buffers rounded up to a power of two, from 64 bytes to max_size, and keeps returned
+// buffers for reuse so that steady-state traffic does not allocate. Not thread safe.
+class BufferPool final {
+  public:
+    // Returns its memory to the pool when destroyed. The pool must outlive it.
+    class Buffer final {
+      friend class BufferPool;
+      private:
+        BufferPool* pool;
+        std::unique_ptr<char[]> memory;
+        size_t size_class;
+        size_t used;
+        Buffer(BufferPool* pool, std::unique_ptr<char[]> memory, size_t size_class, size_t used);
+      public:
+        Buffer(void); // empty
+        Buffer(Buffer&) = delete;
+        Buffer(const Buffer&) = delete;
+        Buffer(Buffer&& o);
+        Buffer& operator=(Buffer&& o);
+        ~Buffer(void);
+        explicit operator bool(void) const noexcept;
+        char* data(void) const noexcept;
+        size_t size(void) const noexcept; // as requested, the capacity may be larger
+        size_t capacity(void) const noexcept;
+    };
+  private:
+    static const size_t MIN_SIZE = 64;
+    static const size_t MAX_CACHED = 64; // per size class, any more are freed
+    const size_t max_size;
+    std::vector<std::vector<std::unique_ptr<char[]>>> free_buffers; // by size class
+    void put(std::unique_ptr<char[]> memory, size_t size_class);
+  public:
+    BufferPool(size_t max_size=1 << 20);
+    BufferPool(BufferPool&) = delete;
+    BufferPool(const BufferPool&) = delete;
+    // Throws std::length_error if size exceeds max_size.
+    Buffer get(size_t size);
+    size_t cached(void) const noexcept; // buffers waiting to be reused
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
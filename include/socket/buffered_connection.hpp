@@ -0,0 +1,41 @@
+#ifndef WRAPPER_SOCKET_BUFFERED_CONNECTION_HPP
+#define WRAPPER_SOCKET_BUFFERED_CONNECTION_HPP
+
+#include "socket.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// Reads from a Connected socket through a fixed-size ring buffer. Each receive pulls in as much
+// as the kernel has queued, and small reads are then served from user space.
+class BufferedConnection final {
+  private:
+    Connected& connection;
+    const size_t capacity; // power of two
+    std::unique_ptr<char[]> buffer;
+    size_t head; // total bytes consumed
+    size_t tail; // total bytes received
+    bool fill(int timeout_ms, std::chrono::steady_clock::time_point deadline);
+    void copy_out(void* buf, size_t count) const;
+  public:
+    BufferedConnection(Connected& connection, size_t capacity=65536);
+    BufferedConnection(BufferedConnection&) = delete;
+    BufferedConnection(const BufferedConnection&) = delete;
+    BufferedConnection(BufferedConnection&& o);
+    size_t buffered(void) const noexcept;
+    size_t get_capacity(void) const noexcept;
+    // Waits until at least count bytes are buffered without consuming them. Returns false on
+    // timeout and throws std::length_error if count exceeds the capacity.
+    bool ensure(size_t count, int timeout_ms=-1);
+    // Returns false on timeout. Unless count exceeds the capacity, the bytes already received stay
+    // buffered for the next call.
+    bool read_exact(void* buf, size_t count, int timeout_ms=-1);
+    bool peek(void* buf, size_t count, int timeout_ms=-1);
+    // Reads up to and including the delimiter, returning the number of bytes read or 0 on timeout.
+    // Throws std::length_error if the delimiter is not within the first max bytes.
+    size_t read_until(void* buf, size_t max, char delimiter, int timeout_ms=-1);
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -0,0 +1,61 @@
+#ifndef WRAPPER_SOCKET_CONNECTION_POOL_HPP
+#define WRAPPER_SOCKET_CONNECTION_POOL_HPP
+
+#include "socket.hpp"
+
+#include <condition_variable>
+#include <unordered_map>
+
+namespace wrapper {
+namespace socket {
+
+// Keeps connected sockets open between requests so that only the first request to a peer pays
+// for the TCP handshake. Sockets are handed out as leases that return them when destroyed.
+class ConnectionPool final {
+  public:
+    class Lease final {
+      friend class ConnectionPool;
+      private:
+        ConnectionPool* pool;
+        std::unique_ptr<Bidirectional> connection;
+        bool reusable;
+        Lease(ConnectionPool* pool, std::unique_ptr<Bidirectional> connection);
+      public:
+        Lease(Lease&) = delete;
+        Lease(const Lease&) = delete;
+        Lease(Lease&& o);
+        ~Lease(void);
+        explicit operator bool(void) const noexcept; // false if acquire timed out
+        Bidirectional& operator*(void) const noexcept;
+        Bidirectional* operator->(void) const noexcept;
+        // Closes the socket when the lease ends instead of returning it, e.g. after a failed or
+        // partially read request.
+        void discard(void) noexcept;
+    };
+  private:
+    struct Peer {
+      std::vector<std::unique_ptr<Bidirectional>> idle; // most recently returned last
+      size_t open = 0; // idle and leased
+      std::condition_variable released;
+    };
+    const size_t max_per_peer;
+    std::mutex mutex;
+    std::unordered_map<Address, Peer> peers;
+    void release(std::unique_ptr<Bidirectional> connection, bool reusable);
+  public:
+    ConnectionPool(size_t max_per_peer=8);
+    ConnectionPool(ConnectionPool&) = delete;
+    ConnectionPool(const ConnectionPool&) = delete;
+    // Every lease must end before the pool is destroyed.
+    ~ConnectionPool(void);
+    // Reuses an idle socket that the peer has not closed, or connects a new one. Once
+    // max_per_peer sockets are leased, waits up to timeout_ms for one to be returned and returns
+    // an empty lease on timeout.
+    Lease acquire(const Address& peer, int timeout_ms=-1);
+    size_t idle(const Address& peer);
+    size_t open(const Address& peer);
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
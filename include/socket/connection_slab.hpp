@@ -0,0 +1,47 @@
+#ifndef WRAPPER_SOCKET_CONNECTION_SLAB_HPP
+#define WRAPPER_SOCKET_CONNECTION_SLAB_HPP
+
+#include "socket.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// Fixed storage for accepted connections. Connections are constructed in place in a free slot
+// and the slot is recycled when the connection is destroyed, so once the slab is allocated,
+// accepting and closing connections does not touch the heap. Not thread safe.
+class ConnectionSlab final {
+  public:
+    class Releaser final {
+      private:
+        ConnectionSlab* slab;
+      public:
+        Releaser(ConnectionSlab* slab=nullptr) : slab(slab) {}
+        void operator()(Bidirectional* connection) const noexcept;
+    };
+    using Connection = std::unique_ptr<Bidirectional, Releaser>;
+  private:
+    union Slot {
+      Slot* next; // while free
+      alignas(Bidirectional) unsigned char storage[sizeof(Bidirectional)];
+    };
+    std::unique_ptr<Slot[]> slots;
+    const size_t capacity;
+    Slot* free_slots;
+    size_t used;
+    void release(Bidirectional* connection) noexcept;
+  public:
+    ConnectionSlab(size_t capacity);
+    ConnectionSlab(ConnectionSlab&) = delete;
+    ConnectionSlab(const ConnectionSlab&) = delete;
+    // Every connection must have been destroyed first.
+    ~ConnectionSlab(void);
+    // Returns nullptr on timeout, or at once when every slot is in use, leaving pending
+    // connections in the backlog.
+    Connection accept(Listening& listener, int timeout_ms=-1, bool nonblocking=false);
+    size_t size(void) const noexcept; // connections in use
+    size_t get_capacity(void) const noexcept;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
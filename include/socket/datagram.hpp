@@ -0,0 +1,49 @@
+#ifndef WRAPPER_SOCKET_DATAGRAM_HPP
+#define WRAPPER_SOCKET_DATAGRAM_HPP
+
+#include "socket.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// A UDP socket that moves many datagrams per system call with recvmmsg and sendmmsg.
+class Datagram final : public Base {
+  public:
+    struct Message {
+      void* buf;
+      size_t size; // capacity when receiving, set to the bytes received
+      Address address; // source when receiving, destination when sending
+      // When sending, buf is split into datagrams of this size by the kernel (UDP GSO). When
+      // receiving with GRO enabled, buf holds datagrams of this size coalesced together, the
+      // last one possibly shorter. 0 means a single datagram.
+      uint16_t segment_size = 0;
+    };
+  private:
+    // Scratch space reused between calls so batches do not allocate.
+    struct Batch {
+      std::vector<mmsghdr> headers;
+      std::vector<iovec> iovecs;
+      std::vector<sockaddr_in6> addresses; // large enough for either family
+      std::vector<char> control;
+      void prepare(size_t count, size_t control_size);
+    };
+    Address address;
+    bool gro;
+    Batch receiving;
+    Batch sending;
+  public:
+    // Binds to port on every interface, or to an ephemeral port when port is 0.
+    Datagram(unsigned short port=0);
+    Datagram(Datagram&& o);
+    // Returns false if the kernel does not support UDP_GRO.
+    bool enable_gro(void);
+    // Waits up to timeout_ms for the first datagram and returns as many as are ready, 0 on
+    // timeout. Datagrams longer than their buffer are truncated.
+    size_t recv_batch(Message* messages, size_t count, int timeout_ms=-1);
+    void send_batch(const Message* messages, size_t count);
+    Address get_address(void) const noexcept;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
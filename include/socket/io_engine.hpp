@@ -0,0 +1,51 @@
+#ifndef WRAPPER_SOCKET_IO_ENGINE_HPP
+#define WRAPPER_SOCKET_IO_ENGINE_HPP
+
+#include "socket.hpp"
+
+#include <functional>
+
+namespace wrapper {
+namespace socket {
+
+// Completion based accept/receive/send. Uses io_uring when the library was built with liburing
+// (SOCKET_HAVE_IO_URING) and the kernel allows it, and otherwise falls back to epoll. Operations
+// are queued and submitted together by run_once(), which also reaps every completion that is
+// ready without a system call per operation.
+class IoEngine final {
+  public:
+    using AcceptHandler = std::function<void(std::unique_ptr<Bidirectional>)>;
+    // Called with count 0 when the peer closes the connection; the receive is then finished.
+    using ReceiveHandler = std::function<void(const char* data, size_t count)>;
+    // Called with 0 once every byte is sent or with the errno of the failed send.
+    using SendHandler = std::function<void(int error)>;
+    class Backend;
+  private:
+    std::unique_ptr<Backend> backend;
+  public:
+    // buffer_count receive buffers of buffer_size bytes are shared by all receiving sockets.
+    IoEngine(unsigned int entries=256, unsigned int buffer_count=256, size_t buffer_size=4096);
+    IoEngine(IoEngine&) = delete;
+    IoEngine(const IoEngine&) = delete;
+    IoEngine(IoEngine&& o);
+    ~IoEngine(void);
+    bool uses_io_uring(void) const noexcept;
+    // Keeps accepting until the listener is removed. When an accept runs out of descriptors or
+    // memory, run_once throws that error once and the listener rests for a moment before
+    // accepting again, instead of failing on every call while the connection waits.
+    void accept(Listening& listener, AcceptHandler handler);
+    // Keeps receiving until the peer closes or the connection is removed.
+    void receive(Connected& connection, ReceiveHandler handler);
+    // buf must stay valid until the handler is called. Sends on one socket complete in order.
+    void send(Bidirectional& connection, const void* buf, size_t count,
+        SendHandler handler=nullptr);
+    // Stops accepting or receiving on the socket. Handlers are not called again and the socket
+    // may be destroyed afterwards.
+    void remove(const Base& socket);
+    // Returns the number of completions handled, 0 on timeout.
+    size_t run_once(int timeout_ms=-1);
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
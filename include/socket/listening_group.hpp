@@ -0,0 +1,36 @@
+#ifndef WRAPPER_SOCKET_LISTENING_GROUP_HPP
+#define WRAPPER_SOCKET_LISTENING_GROUP_HPP
+
+#include "socket.hpp"
+
+#include <vector>
+
+namespace wrapper {
+namespace socket {
+
+// A set of SO_REUSEPORT listeners bound to the same port, one per worker thread. Each listener
+// has its own accept queue and epoll set and the kernel spreads incoming connections across them.
+class ListeningGroup final {
+  private:
+    std::vector<Listening> listeners;
+  public:
+    // SO_REUSEPORT is set whatever the options say.
+    ListeningGroup(unsigned short port, size_t size, SocketOptions options=SocketOptions());
+    ListeningGroup(ListeningGroup&) = delete;
+    ListeningGroup(const ListeningGroup&) = delete;
+    ListeningGroup(ListeningGroup&& o);
+    size_t size(void) const noexcept;
+    Listening& operator[](size_t i);
+    Address get_address(void) const noexcept;
+    // Pins the calling thread to a CPU chosen for listener i, see pin_thread, and asks the kernel
+    // to prefer that listener for connections arriving on the same CPU.
+    void pin(size_t i);
+};
+
+// Pins the calling thread to the i-th CPU it is allowed to run on, modulo their number, and
+// returns that CPU. Inside a cpuset or container the allowed CPUs need not start at 0.
+int pin_thread(size_t i);
+
+} // namespace socket
+} // namespace wrapper
+#endif
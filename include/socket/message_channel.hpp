@@ -0,0 +1,36 @@
+#ifndef WRAPPER_SOCKET_MESSAGE_CHANNEL_HPP
+#define WRAPPER_SOCKET_MESSAGE_CHANNEL_HPP
+
+#include "buffer_pool.hpp"
+#include "buffered_connection.hpp"
+
+namespace wrapper {
+namespace socket {
+
+// Sends and receives frames made of a 4-byte big-endian length followed by the payload. Each
+// frame is sent with one writev, and received frames are read through a ring buffer into
+// buffers drawn from a BufferPool.
+class MessageChannel final {
+  private:
+    Bidirectional& connection;
+    BufferedConnection reader;
+    BufferPool& pool;
+    const uint32_t max_frame_size;
+  public:
+    // The pool may be shared by channels used from the same thread.
+    MessageChannel(Bidirectional& connection, BufferPool& pool, uint32_t max_frame_size=1 << 20,
+        size_t read_capacity=65536);
+    MessageChannel(MessageChannel&) = delete;
+    MessageChannel(const MessageChannel&) = delete;
+    MessageChannel(MessageChannel&& o);
+    void send(const void* buf, uint32_t count);
+    // Returns an empty buffer on timeout, leaving a partly received frame buffered for the next
+    // call. A frame that does not fit in the read buffer is finished without a timeout once it
+    // has started. Throws std::length_error for frames larger than max_frame_size, after which
+    // the channel is no longer usable.
+    BufferPool::Buffer receive(int timeout_ms=-1);
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -0,0 +1,31 @@
+#ifndef WRAPPER_SOCKET_OPTIONS_HPP
+#define WRAPPER_SOCKET_OPTIONS_HPP
+
+namespace wrapper {
+namespace socket {
+
+// Socket options applied once when a socket is created. A 0 leaves the kernel default. Sockets
+// accepted by a Listening inherit its profile: Linux copies the buffer sizes, SO_BUSY_POLL and
+// TCP_NODELAY from the listener, and the listener sets TCP_QUICKACK itself. TCP options are
+// ignored by AF_UNIX sockets.
+struct SocketOptions {
+  bool reuse_address = true; // SO_REUSEADDR, TCP only
+  bool reuse_port = false; // SO_REUSEPORT
+  bool no_delay = false; // TCP_NODELAY, disables Nagle's algorithm
+  // TCP_QUICKACK. The kernel leaves quick ack mode on its own, so this covers the first
+  // exchanges rather than the whole connection.
+  bool quick_ack = false;
+  int send_buffer = 0; // SO_SNDBUF in bytes, doubled by the kernel
+  int receive_buffer = 0; // SO_RCVBUF in bytes, doubled by the kernel
+  int busy_poll_us = 0; // SO_BUSY_POLL, may need CAP_NET_ADMIN above net.core.busy_read
+  // TCP_FASTOPEN queue length on listeners. Connecting sockets use TCP_FASTOPEN_CONNECT when
+  // it is not 0.
+  int fast_open = 0;
+  int defer_accept_s = 0; // TCP_DEFER_ACCEPT, listeners only
+  int backlog = 512; // listeners only
+  bool seqpacket = false; // SOCK_SEQPACKET instead of SOCK_STREAM, AF_UNIX only
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -0,0 +1,55 @@
+#ifndef WRAPPER_SOCKET_REACTOR_HPP
+#define WRAPPER_SOCKET_REACTOR_HPP
+
+#include "socket.hpp"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace wrapper {
+namespace socket {
+
+// Drives many sockets from a single epoll instance. Each call to poll() waits once and dispatches
+// the whole batch of ready sockets to their handlers.
+class Reactor final {
+  public:
+    struct Handlers {
+      std::function<void(void)> read;
+      std::function<void(void)> write;
+      std::function<void(void)> hangup; // peer closed or socket error; read is called if unset
+    };
+  private:
+    struct Registration {
+      int fd;
+      Handlers handlers;
+    };
+    FileDescriptor epfd;
+    std::vector<epoll_event> events;
+    std::unordered_map<int, std::unique_ptr<Registration>> registrations;
+    std::vector<std::unique_ptr<Registration>> removed; // kept alive until the batch is dispatched
+  public:
+    Reactor(size_t max_events=1024);
+    Reactor(Reactor&) = delete;
+    Reactor(const Reactor&) = delete;
+    Reactor(Reactor&& o);
+    ~Reactor(void);
+    // Edge triggered handlers must drain the socket before returning. A socket must be removed
+    // before it is destroyed.
+    void add(const Base& socket, Handlers handlers, uint32_t interest=EPOLLIN,
+        bool edge_triggered=false);
+    void modify(const Base& socket, uint32_t interest, bool edge_triggered=false);
+    void remove(const Base& socket);
+    // For descriptors that are not sockets, such as a timerfd or an eventfd.
+    void add(int fd, Handlers handlers, uint32_t interest=EPOLLIN, bool edge_triggered=false);
+    void modify(int fd, uint32_t interest, bool edge_triggered=false);
+    void remove(int fd);
+    size_t size(void) const noexcept;
+    // Returns the number of sockets dispatched, 0 on timeout or interrupt. If handlers throw, the
+    // rest of the batch is still dispatched and the first exception is thrown afterwards.
+    size_t poll(int timeout_ms=-1);
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
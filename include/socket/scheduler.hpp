@@ -0,0 +1,125 @@
+#ifndef WRAPPER_SOCKET_SCHEDULER_HPP
+#define WRAPPER_SOCKET_SCHEDULER_HPP
+
+#include "reactor.hpp"
+
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#include <exception>
+
+namespace wrapper {
+namespace socket {
+
+// Runs coroutines that co_await socket operations on the calling thread. An operation completes
+// immediately when the socket is ready and otherwise suspends its coroutine until the reactor
+// reports readiness, so many sessions share one thread without a thread or future each.
+class Scheduler final {
+  public:
+    // A coroutine started by spawn(). Exceptions that escape it are rethrown by spawn() or
+    // run_once().
+    class Task final {
+      friend class Scheduler;
+      public:
+        struct promise_type {
+          Scheduler* scheduler = nullptr;
+          ~promise_type(void);
+          Task get_return_object(void) noexcept;
+          std::suspend_always initial_suspend(void) noexcept { return {}; }
+          std::suspend_never final_suspend(void) noexcept { return {}; }
+          void return_void(void) noexcept {}
+          void unhandled_exception(void) noexcept;
+        };
+      private:
+        std::coroutine_handle<promise_type> handle;
+        Task(std::coroutine_handle<promise_type> handle);
+      public:
+        Task(Task&) = delete;
+        Task(const Task&) = delete;
+        Task(Task&& o);
+        ~Task(void);
+    };
+    // Base of the awaitables. attempt() is retried every time the socket becomes ready.
+    class Operation {
+      friend class Scheduler;
+      private:
+        Scheduler& scheduler;
+        const Base& socket;
+        const uint32_t events;
+        std::coroutine_handle<> waiting;
+        std::exception_ptr error;
+        bool try_attempt(void) noexcept;
+      protected:
+        Operation(Scheduler& scheduler, const Base& socket, uint32_t events);
+        virtual bool attempt(void) = 0; // false while the socket would block
+        void rethrow(void) const;
+      public:
+        Operation(Operation&) = delete;
+        Operation(const Operation&) = delete;
+        virtual ~Operation(void);
+        bool await_ready(void) noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+    };
+  private:
+    struct Waiters {
+      Operation* read = nullptr;
+      Operation* write = nullptr;
+    };
+    Reactor reactor;
+    std::unordered_map<const Base*, Waiters> waiting;
+    size_t tasks;
+    std::exception_ptr failure;
+    void wait(Operation& operation);
+    void wake(const Base* socket, uint32_t events);
+    void rethrow_failure(void);
+  public:
+    Scheduler(size_t max_events=1024);
+    Scheduler(Scheduler&) = delete;
+    Scheduler(const Scheduler&) = delete;
+    // Destroys every coroutine that is still suspended.
+    ~Scheduler(void);
+    // Runs the task until its first suspension.
+    void spawn(Task task);
+    size_t size(void) const noexcept; // tasks that have not finished
+    // Returns the number of sockets that became ready, 0 on timeout.
+    size_t run_once(int timeout_ms=-1);
+    // Runs until every task has finished.
+    void run(void);
+};
+
+class AsyncAccept final : public Scheduler::Operation {
+  private:
+    Listening& listener;
+    std::unique_ptr<Bidirectional> connection;
+    bool attempt(void) override;
+  public:
+    AsyncAccept(Scheduler& scheduler, Listening& listener);
+    // The accepted socket is non-blocking.
+    std::unique_ptr<Bidirectional> await_resume(void);
+};
+
+class AsyncRead final : public Scheduler::Operation {
+  private:
+    Connected& connection;
+    char* buf;
+    size_t count;
+    bool attempt(void) override;
+  public:
+    AsyncRead(Scheduler& scheduler, Connected& connection, void* buf, size_t count);
+    void await_resume(void) const;
+};
+
+class AsyncWrite final : public Scheduler::Operation {
+  private:
+    Bidirectional& connection;
+    const char* buf;
+    size_t count;
+    bool attempt(void) override;
+  public:
+    AsyncWrite(Scheduler& scheduler, Bidirectional& connection, const void* buf, size_t count);
+    void await_resume(void) const;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
+#endif
@@ -0,0 +1,46 @@
+#ifndef WRAPPER_SOCKET_SEND_QUEUE_HPP
+#define WRAPPER_SOCKET_SEND_QUEUE_HPP
+
+#include "socket.hpp"
+
+#include <atomic>
+
+namespace wrapper {
+namespace socket {
+
+// Lets several threads send on one Bidirectional without a lock. Buffers are copied onto a
+// lock-free stack, and a single flusher at a time takes the whole stack and sends it in order
+// with one writev. A thread that finds another one flushing returns at once; the flusher sends
+// its buffer too. Buffers pushed by one thread are sent in the order they were pushed.
+class SendQueue final {
+  private:
+    struct Node {
+      Node* next;
+      size_t size;
+      char* data(void) noexcept { return reinterpret_cast<char*>(this + 1); }
+    };
+    Bidirectional& connection;
+    std::atomic<Node*> head; // newest first
+    std::atomic<bool> flushing;
+    static void destroy(Node* node) noexcept;
+  public:
+    SendQueue(Bidirectional& connection);
+    SendQueue(SendQueue&) = delete;
+    SendQueue(const SendQueue&) = delete;
+    ~SendQueue(void);
+    // Pushes the buffer and flushes unless another thread already is. When the queue is empty
+    // and no one is flushing, the buffer is written directly without being copied.
+    void send(const void* buf, size_t count);
+    // Only pushes, for when an event loop owning the connection calls flush().
+    void push(const void* buf, size_t count);
+    // Returns false if another thread is flushing. Buffers it could not send when the write
+    // throws are dropped. The flusher keeps going until the queue is empty, since producers
+    // that find it flushing rely on it to send their buffers, so under sustained load one
+    // thread can end up making every write while the others only push.
+    bool flush(void);
+    bool empty(void) const noexcept;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
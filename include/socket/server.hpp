@@ -0,0 +1,105 @@
+#ifndef WRAPPER_SOCKET_SERVER_HPP
+#define WRAPPER_SOCKET_SERVER_HPP
+
+#include "task_pool.hpp"
+#include "write_buffer.hpp"
+
+#include <chrono>
+#include <optional>
+#include <unordered_map>
+
+namespace wrapper {
+namespace socket {
+
+struct ServerConfig {
+  size_t workers = 0; // reactor threads owning the connections, 0 for one per CPU
+  size_t pool_threads = 0; // threads running the handler, 0 for one per CPU
+  bool pin = true; // pins worker i to the i-th CPU it may run on, see pin_thread
+  size_t max_input = 1 << 20; // unconsumed bytes at which a connection is closed
+  size_t high_watermark = 1 << 20; // queued response bytes at which reading pauses
+  size_t low_watermark = 1 << 18; // and resumes
+  SocketOptions options; // for the listener and the accepted sockets
+};
+
+// A multi-threaded server. One thread accepts connections and hands each to the worker with the
+// fewest; a worker is a thread with its own Reactor that reads and writes its connections and
+// nothing else. Requests run on a work-stealing TaskPool, so a slow request does not hold up the
+// sockets of the worker that received it. A connection has at most one request in the pool and
+// is not read meanwhile, which keeps its responses in order. Responses go out through a
+// WriteBuffer. A connection is closed when a socket call fails or the handler throws, and when the
+// peer shuts down its side once the responses to what it sent have gone out.
+class Server final {
+  public:
+    // Called on a pool thread with the bytes received and not yet consumed. Returns how many of
+    // them it consumed, 0 to wait for more, and appends any reply to response. It is called again
+    // at once if it consumed something and bytes are left.
+    using Handler = std::function<size_t(const char* data, size_t size, std::string& response)>;
+  private:
+    struct Session {
+      std::unique_ptr<Bidirectional> connection;
+      WriteBuffer output;
+      std::string input;
+      std::string response; // these three belong to the pool while busy
+      size_t consumed = 0;
+      bool failed = false;
+      bool busy = false;
+      bool throttled = false; // above the high watermark
+      bool closed = false; // removed from the reactor
+      bool input_ended = false; // the peer shut down its side
+      Session(Reactor& reactor, std::unique_ptr<Bidirectional> connection,
+          const ServerConfig& config);
+    };
+    struct Worker {
+      Reactor reactor;
+      FileDescriptor event; // eventfd signalling the inbox
+      std::mutex mutex;
+      std::vector<std::unique_ptr<Bidirectional>> accepted; // inbox
+      std::vector<Session*> completed; // inbox
+      std::unordered_map<Session*, std::unique_ptr<Session>> sessions;
+      std::vector<char> buffer;
+      std::atomic<size_t> open;
+      std::atomic<bool> stopping;
+      std::thread thread;
+      Worker(void);
+    };
+    const Handler handler;
+    const ServerConfig config;
+    Listening listener;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<TaskPool> pool;
+    Reactor acceptor;
+    FileDescriptor acceptor_event;
+    std::atomic<bool> acceptor_stopping;
+    std::atomic<uint64_t> n_accepted;
+    // Set while the listener is not polled after running out of descriptors or memory.
+    std::optional<std::chrono::steady_clock::time_point> accept_resume;
+    std::thread acceptor_thread;
+    static void notify(const FileDescriptor& event);
+    void run_acceptor(void);
+    void accept(void);
+    void run(Worker& worker, size_t i);
+    void drain(Worker& worker);
+    void start(Worker& worker, std::unique_ptr<Bidirectional> connection);
+    void receive(Worker& worker, Session& session);
+    void end_input(Worker& worker, Session& session);
+    void dispatch(Worker& worker, Session& session);
+    void complete(Worker& worker, Session& session);
+    void resume(Worker& worker, Session& session);
+    void flush(Worker& worker, Session& session);
+    void close(Worker& worker, Session& session);
+  public:
+    // Starts serving at once.
+    Server(const Address& address, Handler handler, const ServerConfig& config=ServerConfig());
+    Server(Server&) = delete;
+    Server(const Server&) = delete;
+    // Stops accepting, closes every connection and waits for the requests still in the pool.
+    ~Server(void);
+    Address get_address(void) const noexcept;
+    size_t connections(void) const noexcept; // open now
+    uint64_t accepted(void) const noexcept; // since the start
+    size_t get_workers(void) const noexcept;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -2,12 +2,18 @@
 #define WRAPPER_SOCKET_SOCKET_HPP
 
 #include "address.hpp"
+#include "options.hpp"
+#include "stats.hpp"
 #include "lock.hpp"
 #include "file_descriptor.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
+#include <climits>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <list>
 #include <memory>
@@ -15,22 +21,42 @@
 #include <poll.h>
 #include <system_error>
 #include <string>
+#include <utility>
+#include <vector>
 #include <sys/epoll.h>
+#include <sys/sendfile.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
 namespace wrapper {
 namespace socket {
 
-#define BACKLOG 512 // TODO templatize
+class Reactor;
+class IoEngine;
+#ifdef __cpp_impl_coroutine
+class Scheduler;
+class AsyncAccept;
+class AsyncRead;
+class AsyncWrite;
+#endif
 
 class Base {
+  friend class Reactor;
+  friend class IoEngine;
+  friend class TlsContext;
   protected:
     FileDescriptor sockfd;
+    bool nonblocking;
+#ifdef SOCKET_STATS
+    SharedCounters counters;
+#endif
   protected:
-    Base(FileDescriptor&& sockfd);
+    Base(FileDescriptor&& sockfd, bool nonblocking=false);
+    Base(int domain, int type, const SocketOptions& options=SocketOptions());
+    bool wait(short events, int timeout_ms) const; // false on timeout
   public:
     Base(void);
     Base(Base&) = delete;
@@ -38,55 +64,169 @@ class Base {
     Base(Base&& o);
     virtual ~Base(void);
     bool data_available(void) const;
+    int get_option(int level, int name) const; // an integer option such as TCP_NODELAY
+    SocketCounters get_counters(void) const noexcept; // all 0 without SOCKET_STATS
 };
 
 class Listening;
+struct ConnectResult;
 
 class Connected : public Base {
+  friend class BufferedConnection;
   private:
     const Address listening_address;
     const Address input_address;
+    bool receive(void* buf, size_t count, int timeout_ms, std::vector<FileDescriptor>* fds);
   protected:
     Connected(const Address& listening, FileDescriptor&& sockfd);
+    Connected(const Address& listening, FileDescriptor&& sockfd, const Address& input,
+        bool nonblocking);
   public:
-    Connected(const Address& listening);
+    Connected(const Address& listening, const SocketOptions& options=SocketOptions());
     Connected(Connected&& o);
     ~Connected(void);
+    // On SOCK_SEQPACKET sockets count should be the size of a whole message, as the rest of a
+    // longer message is discarded.
     bool read(void* buf, size_t count, int timeout_ms=-1);
+    // As read, and appends the descriptors passed with SCM_RIGHTS alongside those bytes. Throws
+    // if the kernel had to drop descriptors that did not fit.
+    bool read_fds(void* buf, size_t count, std::vector<FileDescriptor>& fds, int timeout_ms=-1);
+    // Reads what the socket has without waiting, even on a blocking socket, and returns the
+    // number of bytes read, 0 if there are none. Throws once the peer has closed.
+    size_t try_read(void* buf, size_t count);
+#ifdef __cpp_impl_coroutine
+    // co_await reads exactly count bytes, see Scheduler.
+    AsyncRead async_read(Scheduler& scheduler, void* buf, size_t count);
+#endif
     Address get_listening_address(void) const noexcept; // The address of the Listening socket
     Address get_input_address(void) const noexcept; // The address of the socket returned by accept
     Address get_local_address(void);
+    TcpInfo get_tcp_info(void) const;
+};
+
+// Counts MSG_ZEROCOPY sends and the sends the kernel has released. The kernel numbers sends with
+// a 32-bit counter that wraps, and may report completed ranges out of order, so the count only
+// moves past ranges that start where it stands; later ranges wait until the gap is filled.
+class ZerocopyCompletions final {
+  private:
+    uint64_t sent = 0;
+    uint64_t done = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> ahead; // completed [first, last] past done
+  public:
+    uint64_t send(void) noexcept { return ++sent; } // returns the count as a ticket
+    // Records a notification for the sends [first, last], numbered modulo 2^32.
+    void complete(uint32_t first, uint32_t last);
+    uint64_t get_sent(void) const noexcept { return sent; }
+    uint64_t get_completed(void) const noexcept { return done; } // every send before is released
 };
 
 class Bidirectional final : public Connected {
   friend class Listening;
+  friend class ConnectionSlab;
+  friend std::vector<ConnectResult> connect_many(const std::vector<Address>& addresses,
+      int timeout_ms, const SocketOptions& options);
+  friend std::pair<std::unique_ptr<Bidirectional>, std::unique_ptr<Bidirectional>> socket_pair(
+      const SocketOptions& options);
   private:
     const Address output_address;
+    bool zerocopy = false;
+    ZerocopyCompletions zerocopy_sends;
+    Bidirectional(const Address& listening, FileDescriptor&& sockfd, const Address& input,
+        const Address& output, bool nonblocking);
   public:
     Bidirectional(Listening& listener);
     // This constructor shouldn't be public but is necessary for Listening to call make_unique.
   public:
-    Bidirectional(const Address& listening);
+    Bidirectional(const Address& listening, const SocketOptions& options=SocketOptions());
     Bidirectional(Bidirectional&& o);
     void write(const void* buf, size_t count);
+    // Sends every buffer in order with as few sendmsg calls as the kernel allows. written, if
+    // given, counts the bytes sent so far, also when a later sendmsg throws.
+    void writev(const iovec* iov, size_t iovcnt, size_t* written=nullptr);
+    // Sends what the socket buffer takes without waiting, even on a blocking socket, and returns
+    // the number of bytes sent, 0 if the buffer is full.
+    size_t try_writev(const iovec* iov, size_t iovcnt);
+    // Passes the descriptors with SCM_RIGHTS along with the first bytes of buf. AF_UNIX only, and
+    // count must not be 0.
+    void write_fds(const void* buf, size_t count, const int* fds, size_t n_fds);
+    // Sends count bytes of fd starting at offset without copying them through user space. The
+    // offset is ignored when fd is a pipe.
+    void send_file(int fd, off_t offset, size_t count);
+    // Returns false if the kernel does not support SO_ZEROCOPY. send_zerocopy then copies.
+    bool enable_zerocopy(void);
+    // Returns a ticket; buf may be reused once zerocopy_completed() is at least the ticket.
+    uint64_t send_zerocopy(const void* buf, size_t count);
+    // Reaps completion notifications, waiting up to timeout_ms for one if none are pending.
+    uint64_t zerocopy_completed(int timeout_ms=0);
+#ifdef __cpp_impl_coroutine
+    // co_await writes every byte, see Scheduler.
+    AsyncWrite async_write(Scheduler& scheduler, const void* buf, size_t count);
+#endif
     Address get_address(void) const noexcept; // This socket's output address
 };
 
 class Listening final : public Base {
   friend class Bidirectional;
+  friend class ListeningGroup;
+  friend class IoEngine;
+  friend class AsyncAccept;
+  friend class ConnectionSlab;
   private:
     Address address;
+    Address local_address;
+    bool bound_to_any;
+    bool quick_ack; // not inherited by accepted sockets
     FileDescriptor listen_epfd;
     Mutex mutex;
+    std::unique_ptr<Bidirectional> accept_one(int flags);
+    // Returns -1 once the backlog is drained.
+    int accept_fd(int flags, Address& peer);
+    // Applies the per-connection options to a socket accepted from this listener and returns its
+    // local address.
+    Address prepare_accepted(int fd);
+    // Wraps a socket accepted from this listener.
+    std::unique_ptr<Bidirectional> adopt(FileDescriptor&& fd, const Address& peer,
+        bool nonblocking);
+    std::unique_ptr<Bidirectional> adopt(FileDescriptor&& fd, bool nonblocking);
   public:
-    Listening(unsigned short port);
+    // Binds every interface. get_address() then returns the address of the first interface
+    // that is up, or the loopback address when there is none.
+    Listening(unsigned short port, const SocketOptions& options=SocketOptions());
+    // Binds a single interface, or an ephemeral port when the port is 0. An AF_UNIX path is
+    // unlinked when the listener is destroyed.
+    Listening(const Address& bind_address, const SocketOptions& options=SocketOptions());
     Listening(Listening&& o);
     ~Listening(void);
+    // Returns nullptr on timeout, or when another thread or process accepting from the same
+    // socket took the connection first.
     std::unique_ptr<Bidirectional> accept(int timeout_ms=-1);
+    // Accepts up to max pending connections after a single wakeup, returning non-blocking sockets.
+    // An error after some connections were accepted ends the batch early and is thrown by the
+    // next call instead, so those connections are not lost.
+    std::vector<std::unique_ptr<Bidirectional>> accept_batch(size_t max, int timeout_ms=-1);
+#ifdef __cpp_impl_coroutine
+    // co_await returns a non-blocking socket, see Scheduler.
+    AsyncAccept async_accept(Scheduler& scheduler);
+#endif
     Address get_address(void) const noexcept;
 };
 
-std::string get_my_ip(void);
+struct ConnectResult {
+  std::unique_ptr<Bidirectional> connection; // nullptr if the connect failed
+  int error; // 0, the errno of the failed connect, or ETIMEDOUT
+};
+
+// Starts a non-blocking connect to every address at once and waits for all of them on one epoll
+// set, so the whole fan-out takes about one round trip. Results are in the order of addresses
+// and the connected sockets are non-blocking.
+std::vector<ConnectResult> connect_many(const std::vector<Address>& addresses,
+    int timeout_ms=-1, const SocketOptions& options=SocketOptions());
+
+// Two connected AF_UNIX sockets, for talking to a child process or another thread.
+std::pair<std::unique_ptr<Bidirectional>, std::unique_ptr<Bidirectional>> socket_pair(
+    const SocketOptions& options=SocketOptions());
+
+std::string get_my_ip(void); // cached after the first call
 } // namespace socket
 } // namespace wrapper
 #endif
@@ -0,0 +1,113 @@
+#ifndef WRAPPER_SOCKET_STATS_HPP
+#define WRAPPER_SOCKET_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace wrapper {
+namespace socket {
+
+// Counters kept per socket and per thread when the library is built with SOCKET_STATS. Without
+// it the recording calls compile to nothing and every counter reads 0.
+struct SocketCounters {
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t read_calls = 0; // receive system calls that returned data
+  uint64_t write_calls = 0; // send, sendfile and splice system calls that sent data
+  uint64_t partial_writes = 0; // sends that took only part of what was offered
+  uint64_t would_block = 0; // receive, send and accept calls that returned EAGAIN instead
+  uint64_t timeouts = 0;
+  uint64_t accepts = 0;
+  SocketCounters& operator+=(const SocketCounters& o);
+};
+
+enum StatsOperation { STATS_ACCEPT, STATS_READ, STATS_WRITE, STATS_OPERATIONS };
+
+// Latencies in power-of-two buckets: bucket i counts calls that took [2^i, 2^(i+1)) ns.
+struct LatencyHistogram {
+  static const size_t BUCKETS = 64;
+  uint64_t buckets[BUCKETS] = {};
+  uint64_t count(void) const noexcept;
+  // Upper bound in ns of the bucket holding the given fraction of calls, 0 if there are none.
+  uint64_t percentile(double fraction) const noexcept;
+};
+
+struct StatsSnapshot {
+  SocketCounters counters;
+  LatencyHistogram latency[STATS_OPERATIONS];
+};
+
+// Sums the counters of every thread, including threads that have exited.
+StatsSnapshot get_stats(void);
+
+struct TcpInfo {
+  uint8_t state;
+  uint32_t rtt_us;
+  uint32_t rtt_var_us;
+  uint32_t cwnd; // in segments
+  uint32_t ssthresh;
+  uint32_t unacked;
+  uint32_t lost;
+  uint32_t retransmits; // of the segment currently being retransmitted
+  uint32_t total_retransmits;
+};
+
+#ifdef SOCKET_STATS
+// Per-thread aggregate. Only its own thread writes it, so relaxed loads and stores suffice and
+// threads never contend on a shared cache line.
+struct ThreadStats {
+  std::atomic<uint64_t> counters[sizeof(SocketCounters) / sizeof(uint64_t)];
+  std::atomic<uint64_t> latency[STATS_OPERATIONS][LatencyHistogram::BUCKETS];
+  ThreadStats(void);
+  ~ThreadStats(void);
+};
+ThreadStats& get_thread_stats(void);
+
+// Per-socket counters. A reader and a writer thread on the same socket, or threads accepting
+// from the same listener, add to them concurrently, so each one is a relaxed atomic.
+struct SharedCounters {
+  std::atomic<uint64_t> counters[sizeof(SocketCounters) / sizeof(uint64_t)];
+  SharedCounters(void);
+  void add(const SocketCounters& delta) noexcept;
+  SocketCounters load(void) const noexcept;
+};
+
+// Collects the counters of one call and adds them to the socket and the thread when destroyed.
+class StatsRecorder final {
+  private:
+    SharedCounters& socket;
+    const StatsOperation operation;
+    const std::chrono::steady_clock::time_point start;
+    SocketCounters delta;
+  public:
+    StatsRecorder(SharedCounters& socket, StatsOperation operation) : socket(socket),
+        operation(operation), start(std::chrono::steady_clock::now()) {}
+    ~StatsRecorder(void);
+    void read(uint64_t bytes) noexcept { delta.read_calls++; delta.bytes_read += bytes; }
+    void write(uint64_t bytes, bool partial) noexcept {
+      delta.write_calls++;
+      delta.bytes_written += bytes;
+      delta.partial_writes += partial;
+    }
+    void would_block(void) noexcept { delta.would_block++; }
+    void timeout(void) noexcept { delta.timeouts++; }
+    void accept(void) noexcept { delta.accepts++; }
+};
+#define SOCKET_STATS_RECORD(recorder, counters, operation) \
+    StatsRecorder recorder(counters, operation)
+#else
+class StatsRecorder final {
+  public:
+    void read(uint64_t) noexcept {}
+    void write(uint64_t, bool) noexcept {}
+    void would_block(void) noexcept {}
+    void timeout(void) noexcept {}
+    void accept(void) noexcept {}
+};
+#define SOCKET_STATS_RECORD(recorder, counters, operation) StatsRecorder recorder
+#endif
+
+} // namespace socket
+} // namespace wrapper
+#endif
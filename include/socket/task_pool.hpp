@@ -0,0 +1,51 @@
+#ifndef WRAPPER_SOCKET_TASK_POOL_HPP
+#define WRAPPER_SOCKET_TASK_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wrapper {
+namespace socket {
+
+// Runs tasks on a fixed set of threads, each with its own deque. A task submitted from a pool
+// thread goes to the back of that thread's deque, which its owner empties newest first, while
+// idle threads steal the oldest tasks from the front of the others. Tasks submitted from other
+// threads go to a shared queue that every thread takes from in submission order once its own
+// deque is empty, so they start first come, first served.
+class TaskPool final {
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<std::function<void(void)>> tasks;
+    };
+    const size_t n_threads;
+    std::unique_ptr<Queue[]> queues;
+    Queue injected; // outside submissions
+    std::vector<std::thread> threads;
+    std::atomic<size_t> pending; // queued and not yet taken
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    bool take(size_t i, std::function<void(void)>& task);
+    void run(size_t i);
+  public:
+    // 0 starts one thread per CPU.
+    TaskPool(size_t n_threads=0);
+    TaskPool(TaskPool&) = delete;
+    TaskPool(const TaskPool&) = delete;
+    // Runs every task still queued, including those they submit, before joining the threads.
+    ~TaskPool(void);
+    // Tasks must not throw.
+    void submit(std::function<void(void)> task);
+    size_t size(void) const noexcept;
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
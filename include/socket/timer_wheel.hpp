@@ -0,0 +1,71 @@
+#ifndef WRAPPER_SOCKET_TIMER_WHEEL_HPP
+#define WRAPPER_SOCKET_TIMER_WHEEL_HPP
+
+#include "reactor.hpp"
+
+#include <chrono>
+#include <functional>
+
+namespace wrapper {
+namespace socket {
+
+// Deadlines for many connections driven by one periodic timerfd registered on a Reactor. Timers
+// hash into a ring of slots by expiry tick and sit in intrusive lists, so arming, resetting and
+// cancelling are O(1) and each tick only visits one slot. Timers fire from inside Reactor::poll,
+// never before the delay and, while the reactor polls promptly, at most two ticks after it, as
+// the ticks keep the phase they started with. The timerfd is disarmed while no timer is armed.
+class TimerWheel final {
+  private:
+    struct Link {
+      Link* prev;
+      Link* next;
+    };
+  public:
+    // Typically one per connection, for an idle or request deadline. A timer must outlive its
+    // arming or be cancelled, which its destructor does.
+    class Timer final : private Link {
+      friend class TimerWheel;
+      private:
+        TimerWheel* wheel = nullptr; // while armed
+        size_t rounds = 0; // turns of the wheel left before it fires
+        std::function<void(void)> callback;
+      public:
+        Timer(std::function<void(void)> callback);
+        Timer(Timer&) = delete;
+        Timer(const Timer&) = delete;
+        ~Timer(void);
+        bool armed(void) const noexcept;
+    };
+  private:
+    Reactor& reactor;
+    FileDescriptor timerfd;
+    const std::chrono::milliseconds tick;
+    std::vector<Link> slots; // list heads, each linked to itself when empty
+    Link expired;
+    size_t current;
+    size_t n_armed;
+    void start(void); // starts ticking when the first timer is armed
+    void stop(void) noexcept; // and stops when the last one fires or is cancelled
+    uint64_t elapsed(void); // ticks since the last read of the timerfd
+    void turn(uint64_t ticks) noexcept; // moves the timers due in the next ticks to expired
+    static void link(Link& head, Link& node) noexcept;
+    static void unlink(Link& node) noexcept;
+  public:
+    // The wheel spans slots * tick before timers need more than one turn.
+    TimerWheel(Reactor& reactor, std::chrono::milliseconds tick=std::chrono::milliseconds(10),
+        size_t slots=4096);
+    TimerWheel(TimerWheel&) = delete;
+    TimerWheel(const TimerWheel&) = delete;
+    ~TimerWheel(void);
+    // Arms the timer, or moves its deadline if it is already armed.
+    void arm(Timer& timer, std::chrono::milliseconds delay);
+    void cancel(Timer& timer) noexcept;
+    // Processes every tick elapsed since the last call in one batch and returns the number of
+    // timers fired. Called by the Reactor when the timerfd is readable.
+    size_t advance(void);
+    size_t size(void) const noexcept; // armed timers
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
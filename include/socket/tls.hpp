@@ -0,0 +1,45 @@
+#ifndef WRAPPER_SOCKET_TLS_HPP
+#define WRAPPER_SOCKET_TLS_HPP
+
+#ifdef SOCKET_HAVE_TLS
+#include "socket.hpp"
+
+#include <openssl/ssl.h>
+
+namespace wrapper {
+namespace socket {
+
+// Kernel TLS. OpenSSL does the handshake in user space and then hands the session keys to the
+// kernel, after which the connection's read, write, writev and send_file are encrypted and
+// decrypted by the kernel with the usual API. Only AES-GCM and ChaCha20-Poly1305 suites, which
+// the kernel implements, are offered, and servers send no session tickets. Built when OpenSSL 3
+// is found (SOCKET_HAVE_TLS); offload also needs the kernel tls module.
+class TlsContext final {
+  private:
+    std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> context;
+    bool is_server;
+    TlsContext(SSL_CTX* context, bool is_server);
+  public:
+    // PEM files.
+    static TlsContext server(const std::string& certificate_file, const std::string& key_file);
+    // A server with a new P-256 key and a self-signed certificate, for tests and development.
+    static TlsContext self_signed(const std::string& common_name);
+    // Verifies the server against ca_file, or the default trust store when it is empty. Offers
+    // only TLS 1.2, since session tickets a TLS 1.3 server sends cannot be read through the kernel.
+    static TlsContext client(const std::string& ca_file="", bool verify=true);
+    TlsContext(TlsContext&) = delete;
+    TlsContext(const TlsContext&) = delete;
+    TlsContext(TlsContext&& o);
+    SSL_CTX* get(void) const noexcept; // for any further configuration
+    // Handshakes over the connection, waiting as needed if it is non-blocking, and enables kernel
+    // TLS in both directions. Throws std::runtime_error if the handshake fails and
+    // std::system_error with ENOPROTOOPT if the session could not be offloaded; either way the
+    // connection must then be closed. A client checks the certificate against server_name.
+    void handshake(Bidirectional& connection, const std::string& server_name="") const;
+    static bool kernel_supported(void); // the tls module is available
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
+#endif
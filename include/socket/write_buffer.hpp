@@ -0,0 +1,66 @@
+#ifndef WRAPPER_SOCKET_WRITE_BUFFER_HPP
+#define WRAPPER_SOCKET_WRITE_BUFFER_HPP
+
+#include "reactor.hpp"
+
+#include <deque>
+#include <functional>
+
+namespace wrapper {
+namespace socket {
+
+struct WriteWatermarks {
+  size_t high = 1 << 20; // pending bytes at which the writer should stop
+  size_t low = 1 << 18; // pending bytes at which it may resume
+  std::function<void(void)> on_high; // called once when pending() reaches high
+  std::function<void(void)> on_low; // then once when it falls back to low
+};
+
+// Non-blocking writes for a connection driven by a Reactor. What the socket does not take at
+// once is queued in a chain of blocks and sent when the socket becomes writable again, so a slow
+// peer never blocks the thread. EPOLLOUT is only armed while data is queued. The connection must
+// be registered with the given interest and trigger mode and a write handler that calls flush().
+class WriteBuffer final {
+  private:
+    struct Block {
+      std::unique_ptr<char[]> data;
+      size_t capacity;
+      size_t begin;
+      size_t end;
+    };
+    static constexpr size_t BLOCK_SIZE = 16384;
+    Reactor& reactor;
+    Bidirectional& connection;
+    uint32_t interest;
+    bool edge_triggered;
+    WriteWatermarks watermarks;
+    std::deque<Block> blocks;
+    size_t size;
+    bool above_high;
+    bool armed; // EPOLLOUT is in the interest set
+    void append(const char* buf, size_t count);
+    void consume(size_t count);
+    void arm(bool writable);
+  public:
+    WriteBuffer(Reactor& reactor, Bidirectional& connection,
+        WriteWatermarks watermarks=WriteWatermarks(), uint32_t interest=EPOLLIN,
+        bool edge_triggered=false);
+    WriteBuffer(WriteBuffer&) = delete;
+    WriteBuffer(const WriteBuffer&) = delete;
+    WriteBuffer(WriteBuffer&& o);
+    // Never blocks. Returns false while pending() is at or above the high watermark, telling the
+    // caller to stop writing until on_low; the data is queued either way.
+    bool write(const void* buf, size_t count);
+    // Sends as much queued data as the socket takes. Called from the write handler.
+    void flush(void);
+    size_t pending(void) const noexcept;
+    // Changes the events watched besides EPOLLOUT, e.g. 0 to stop reading for a while.
+    void set_interest(uint32_t interest);
+    // Changes the trigger mode, e.g. to edge once the peer has shut down its side, which the
+    // reactor would otherwise report on every poll.
+    void set_edge_triggered(bool edge_triggered);
+};
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -1,25 +1,156 @@
 #include "socket/address.hpp"
 
+#include <cstddef>
 #include <cstring>
+#include <stdexcept>
+#include <string_view>
 
 namespace wrapper {
 namespace socket {
 
-Address::Address(const std::string& ip, unsigned short port) : _port(port) {
-  std::strncpy(_ip, ip.c_str(), INET_ADDRSTRLEN);
+Address::Address(void) {
+  std::memset(&storage, 0, sizeof(storage));
+  storage.any.sa_family = AF_UNSPEC;
+  local_size = 0;
 }
 
-const std::string Address::ip(void) const { return std::string(_ip); }
+Address::Address(const std::string& ip, unsigned short port) : Address() {
+  if (inet_pton(AF_INET, ip.c_str(), &storage.v4.sin_addr) == 1) {
+    storage.v4.sin_family = AF_INET;
+    storage.v4.sin_port = htons(port);
+  } else if (inet_pton(AF_INET6, ip.c_str(), &storage.v6.sin6_addr) == 1) {
+    storage.v6.sin6_family = AF_INET6;
+    storage.v6.sin6_port = htons(port);
+  } else {
+    throw std::runtime_error("invalid address");
+  }
+}
+
+Address::Address(const sockaddr_in& addr) : Address() {
+  storage.v4.sin_family = AF_INET;
+  storage.v4.sin_port = addr.sin_port;
+  storage.v4.sin_addr = addr.sin_addr;
+}
+
+Address::Address(const sockaddr_in6& addr) : Address() {
+  storage.v6.sin6_family = AF_INET6;
+  storage.v6.sin6_port = addr.sin6_port;
+  storage.v6.sin6_addr = addr.sin6_addr;
+  storage.v6.sin6_scope_id = addr.sin6_scope_id;
+}
+
+static const size_t PATH_OFFSET = offsetof(sockaddr_un, sun_path);
+static const size_t MAX_PATH = sizeof(sockaddr_un::sun_path) - 1; // leaves a terminating 0
+
+Address::Address(const sockaddr* addr, socklen_t size) : Address() {
+  if (addr->sa_family == AF_INET && size >= sizeof(sockaddr_in)) {
+    *this = Address(*reinterpret_cast<const sockaddr_in*>(addr));
+  } else if (addr->sa_family == AF_INET6 && size >= sizeof(sockaddr_in6)) {
+    *this = Address(*reinterpret_cast<const sockaddr_in6*>(addr));
+  } else if (addr->sa_family == AF_UNIX && size >= sizeof(sa_family_t) &&
+      size <= sizeof(sockaddr_un)) {
+    const char* name = reinterpret_cast<const sockaddr_un*>(addr)->sun_path;
+    size_t length = size - PATH_OFFSET;
+    if (length == 0 || name[0] == '\0') { // unnamed or abstract, every byte counts
+      std::memcpy(&storage.local, addr, size);
+      local_size = size;
+    } else {
+      *this = local_path(std::string(name, strnlen(name, length)));
+    }
+  } else {
+    throw std::runtime_error("unsupported address family");
+  }
+}
+
+Address Address::local_path(const std::string& path) {
+  if (path.empty() || path.size() > MAX_PATH || path.find('\0') != std::string::npos)
+    throw std::runtime_error("invalid socket path");
+  Address a;
+  a.storage.local.sun_family = AF_UNIX;
+  std::memcpy(a.storage.local.sun_path, path.data(), path.size());
+  a.local_size = PATH_OFFSET + path.size() + 1;
+  return a;
+}
+
+Address Address::local_abstract(const std::string& name) {
+  // Names with 0 bytes are not supported, so the length is implied by the zeroed tail. The name
+  // starts after the leading 0, so one byte less fits than in a path.
+  if (name.size() > MAX_PATH - 1 || name.find('\0') != std::string::npos)
+    throw std::runtime_error("invalid abstract socket name");
+  Address a;
+  a.storage.local.sun_family = AF_UNIX;
+  std::memcpy(a.storage.local.sun_path + 1, name.data(), name.size());
+  a.local_size = PATH_OFFSET + (name.empty() ? 0 : 1 + name.size());
+  return a;
+}
+
+const std::string Address::ip(void) const {
+  if (storage.any.sa_family != AF_INET && storage.any.sa_family != AF_INET6)
+    return std::string();
+  char dst[INET6_ADDRSTRLEN];
+  const void* src = storage.any.sa_family == AF_INET6 ? (const void*) &storage.v6.sin6_addr :
+      (const void*) &storage.v4.sin_addr;
+  if (inet_ntop(storage.any.sa_family, src, dst, INET6_ADDRSTRLEN) != dst)
+    throw std::runtime_error("inet_ntop failed");
+  return std::string(dst);
+}
 
-const unsigned short Address::port(void) const { return _port; }
+const unsigned short Address::port(void) const {
+  if (storage.any.sa_family != AF_INET && storage.any.sa_family != AF_INET6)
+    return 0;
+  // sin_port and sin6_port share an offset.
+  return ntohs(storage.v4.sin_port);
+}
+
+const std::string Address::path(void) const {
+  if (storage.any.sa_family != AF_UNIX)
+    return std::string();
+  const char* name = storage.local.sun_path;
+  if (local_size == PATH_OFFSET)
+    return std::string();
+  if (name[0] == '\0')
+    return "@" + std::string(name + 1, local_size - PATH_OFFSET - 1);
+  return std::string(name);
+}
+
+sa_family_t Address::family(void) const noexcept {
+  return storage.any.sa_family;
+}
+
+bool Address::is_any(void) const noexcept {
+  if (storage.any.sa_family == AF_INET6)
+    return IN6_IS_ADDR_UNSPECIFIED(&storage.v6.sin6_addr);
+  return storage.any.sa_family == AF_INET && storage.v4.sin_addr.s_addr == htonl(INADDR_ANY);
+}
+
+const sockaddr* Address::get_sockaddr(void) const noexcept {
+  return &storage.any;
+}
+
+socklen_t Address::get_sockaddr_size(void) const noexcept {
+  if (storage.any.sa_family == AF_UNIX)
+    return local_size;
+  return storage.any.sa_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+}
+
+size_t Address::hash(void) const noexcept {
+  return std::hash<std::string_view>()(
+      std::string_view(reinterpret_cast<const char*>(&storage), get_sockaddr_size()));
+}
 
 bool Address::operator==(const Address& o) const {
-  return _port == o._port && !std::strncmp(_ip, o._ip, INET_ADDRSTRLEN);
+  socklen_t size = get_sockaddr_size();
+  return storage.any.sa_family == o.storage.any.sa_family && size == o.get_sockaddr_size() &&
+      !std::memcmp(&storage, &o.storage, size);
 }
 
 bool Address::operator!=(const Address& o) const { return !(*this == o); }
 
 std::ostream& operator<<(std::ostream& os, const Address& a) {
+  if (a.family() == AF_UNIX)
+    return os << "unix:" << a.path();
+  if (a.family() == AF_INET6)
+    return os << "[" << a.ip() << "]:" << std::to_string(a.port());
   return os << a.ip() << ":" << std::to_string(a.port());
 }
 
@@ -0,0 +1,67 @@
+#include "socket/batched_writer.hpp"
+
+namespace wrapper {
+namespace socket {
+
+BatchedWriter::BatchedWriter(Bidirectional& connection, size_t threshold) :
+    connection(connection), threshold(threshold) {
+  if (threshold == 0)
+    throw std::invalid_argument("threshold must be positive");
+  buffer.reserve(threshold);
+}
+
+BatchedWriter::BatchedWriter(BatchedWriter&& o) : connection(o.connection),
+    threshold(o.threshold), buffer(std::move(o.buffer)) {
+  o.buffer.clear();
+}
+
+BatchedWriter::~BatchedWriter(void) {
+  try {
+    flush();
+  } catch (const std::exception& e) {
+    std::cerr << "WARNING: batched writer flush failed: " << e.what() << std::endl;
+  }
+}
+
+void BatchedWriter::write(const void* buf, size_t count) {
+  if (buffer.size() + count < threshold) {
+    buffer.insert(buffer.end(), (const char*) buf, &((const char*) buf)[count]);
+    return;
+  }
+  // Send what is buffered together with the new data instead of copying it.
+  iovec iov[2] = {{buffer.data(), buffer.size()}, {const_cast<void*>(buf), count}};
+  send(iov, 2);
+}
+
+void BatchedWriter::flush(void) {
+  if (buffer.empty())
+    return;
+  iovec iov{buffer.data(), buffer.size()};
+  send(&iov, 1);
+}
+
+size_t BatchedWriter::pending(void) const noexcept {
+  return buffer.size();
+}
+
+void BatchedWriter::send(const iovec* iov, size_t iovcnt) {
+  size_t sent = 0;
+  try {
+    connection.writev(iov, iovcnt, &sent);
+  } catch (...) {
+    // Sending the prefix that went out again would duplicate it, keep only the tail.
+    std::vector<char> unsent;
+    for (size_t i = 0; i < iovcnt; i++) {
+      size_t skip = std::min(sent, iov[i].iov_len);
+      sent -= skip;
+      const char* base = (const char*) iov[i].iov_base;
+      unsent.insert(unsent.end(), &base[skip], &base[iov[i].iov_len]);
+    }
+    buffer = std::move(unsent);
+    throw;
+  }
+  buffer.clear();
+}
+
+} // namespace socket
+} // namespace wrapper
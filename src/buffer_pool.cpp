@@ -0,0 +1,85 @@
+#include "socket/buffer_pool.hpp"
+
+#include <stdexcept>
+
+namespace wrapper {
+namespace socket {
+
+static size_t get_size_class(size_t size, size_t min_size) {
+  size_t size_class = 0;
+  for (size_t capacity = min_size; capacity < size; capacity <<= 1)
+    size_class++;
+  return size_class;
+}
+
+BufferPool::Buffer::Buffer(BufferPool* pool, std::unique_ptr<char[]> memory, size_t size_class,
+    size_t used) : pool(pool), memory(std::move(memory)), size_class(size_class), used(used) {}
+
+BufferPool::Buffer::Buffer(void) : pool(nullptr), size_class(0), used(0) {}
+
+BufferPool::Buffer::Buffer(Buffer&& o) : pool(o.pool), memory(std::move(o.memory)),
+    size_class(o.size_class), used(o.used) {}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& o) {
+  if (this == &o)
+    return *this;
+  if (memory)
+    pool->put(std::move(memory), size_class);
+  pool = o.pool;
+  memory = std::move(o.memory);
+  size_class = o.size_class;
+  used = o.used;
+  return *this;
+}
+
+BufferPool::Buffer::~Buffer(void) {
+  if (memory)
+    pool->put(std::move(memory), size_class);
+}
+
+BufferPool::Buffer::operator bool(void) const noexcept {
+  return memory != nullptr;
+}
+
+char* BufferPool::Buffer::data(void) const noexcept {
+  return memory.get();
+}
+
+size_t BufferPool::Buffer::size(void) const noexcept {
+  return used;
+}
+
+size_t BufferPool::Buffer::capacity(void) const noexcept {
+  return MIN_SIZE << size_class;
+}
+
+BufferPool::BufferPool(size_t max_size) : max_size(max_size),
+    free_buffers(get_size_class(max_size, MIN_SIZE) + 1) {}
+
+BufferPool::Buffer BufferPool::get(size_t size) {
+  if (size > max_size)
+    throw std::length_error("buffer larger than the pool maximum");
+  size_t size_class = get_size_class(size, MIN_SIZE);
+  std::vector<std::unique_ptr<char[]>>& cache = free_buffers[size_class];
+  if (cache.empty())
+    return Buffer(this, std::make_unique<char[]>(MIN_SIZE << size_class), size_class, size);
+  std::unique_ptr<char[]> memory(std::move(cache.back()));
+  cache.pop_back();
+  return Buffer(this, std::move(memory), size_class, size);
+}
+
+void BufferPool::put(std::unique_ptr<char[]> memory, size_t size_class) {
+  std::vector<std::unique_ptr<char[]>>& cache = free_buffers[size_class];
+  if (cache.size() < MAX_CACHED)
+    cache.push_back(std::move(memory));
+}
+
+size_t BufferPool::cached(void) const noexcept {
+  size_t n = 0;
+  for (auto& cache : free_buffers)
+    n += cache.size();
+  return n;
+}
+
+} // namespace socket
+} // namespace wrapper
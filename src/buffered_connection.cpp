@@ -0,0 +1,139 @@
+#include "socket/buffered_connection.hpp"
+
+#include <sys/uio.h>
+
+namespace wrapper {
+namespace socket {
+
+static std::chrono::steady_clock::time_point get_deadline(int timeout_ms) {
+  if (timeout_ms <= 0)
+    return std::chrono::steady_clock::time_point();
+  return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+}
+
+// What is left of timeout_ms at this point, so that every wait of a call shares one deadline.
+static int get_remaining_ms(int timeout_ms, std::chrono::steady_clock::time_point deadline) {
+  if (timeout_ms <= 0)
+    return timeout_ms;
+  return std::max<long>(0, std::chrono::ceil<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count());
+}
+
+BufferedConnection::BufferedConnection(Connected& connection, size_t capacity) :
+    connection(connection), capacity(capacity), buffer(std::make_unique<char[]>(capacity)),
+    head(0), tail(0) {
+  if (capacity == 0 || (capacity & (capacity - 1)))
+    throw std::invalid_argument("buffer capacity must be a power of two");
+}
+
+BufferedConnection::BufferedConnection(BufferedConnection&& o) : connection(o.connection),
+    capacity(o.capacity), buffer(std::move(o.buffer)), head(o.head), tail(o.tail) {}
+
+size_t BufferedConnection::buffered(void) const noexcept {
+  return tail - head;
+}
+
+size_t BufferedConnection::get_capacity(void) const noexcept {
+  return capacity;
+}
+
+bool BufferedConnection::fill(int timeout_ms, std::chrono::steady_clock::time_point deadline) {
+  size_t free = capacity - buffered();
+  assert(free > 0);
+  size_t start = tail & (capacity - 1);
+  size_t first = std::min(free, capacity - start);
+  iovec iov[2] = {{&buffer[start], first}, {&buffer[0], free - first}};
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = free > first ? 2 : 1;
+  int flags = timeout_ms == -1 ? 0 : MSG_DONTWAIT;
+  SOCKET_STATS_RECORD(stats, connection.counters, STATS_READ);
+  while (true) {
+    ssize_t ret = ::recvmsg(connection.sockfd.get(), &msg, flags);
+    if (ret > 0) {
+      stats.read(ret);
+      tail += ret;
+      return true;
+    }
+    if (ret == 0)
+      throw std::system_error(ECONNRESET, std::generic_category(), "socket closed by peer");
+    if (errno == EINTR)
+      continue;
+    if (errno != EAGAIN)
+      throw std::system_error(errno, std::generic_category(), "socket read failed");
+    stats.would_block();
+    if (!connection.wait(POLLIN, get_remaining_ms(timeout_ms, deadline))) {
+      stats.timeout();
+      return false;
+    }
+  }
+}
+
+void BufferedConnection::copy_out(void* buf, size_t count) const {
+  size_t start = head & (capacity - 1);
+  size_t first = std::min(count, capacity - start);
+  std::memcpy(buf, &buffer[start], first);
+  std::memcpy(&((char*) buf)[first], &buffer[0], count - first);
+}
+
+bool BufferedConnection::read_exact(void* buf, size_t count, int timeout_ms) {
+  std::chrono::steady_clock::time_point deadline = get_deadline(timeout_ms);
+  if (count > capacity) {
+    // Too large to stage; hand over what is buffered and read the rest directly.
+    size_t n = buffered();
+    copy_out(buf, n);
+    head += n;
+    return connection.read(&((char*) buf)[n], count - n, get_remaining_ms(timeout_ms, deadline));
+  }
+  while (buffered() < count)
+    if (!fill(timeout_ms, deadline))
+      return false;
+  copy_out(buf, count);
+  head += count;
+  return true;
+}
+
+bool BufferedConnection::ensure(size_t count, int timeout_ms) {
+  if (count > capacity)
+    throw std::length_error("count larger than buffer capacity");
+  std::chrono::steady_clock::time_point deadline = get_deadline(timeout_ms);
+  while (buffered() < count)
+    if (!fill(timeout_ms, deadline))
+      return false;
+  return true;
+}
+
+bool BufferedConnection::peek(void* buf, size_t count, int timeout_ms) {
+  if (!ensure(count, timeout_ms))
+    return false;
+  copy_out(buf, count);
+  return true;
+}
+
+size_t BufferedConnection::read_until(void* buf, size_t max, char delimiter, int timeout_ms) {
+  std::chrono::steady_clock::time_point deadline = get_deadline(timeout_ms);
+  size_t limit = std::min(max, capacity);
+  size_t searched = 0;
+  while (true) {
+    size_t available = std::min(buffered(), limit);
+    while (searched < available) {
+      size_t start = (head + searched) & (capacity - 1);
+      size_t length = std::min(available - searched, capacity - start);
+      const char* found = static_cast<const char*>(std::memchr(&buffer[start], delimiter, length));
+      if (found) {
+        size_t count = searched + (found - &buffer[start]) + 1;
+        copy_out(buf, count);
+        head += count;
+        return count;
+      }
+      searched += length;
+    }
+    if (searched == limit)
+      throw std::length_error("delimiter not found");
+    if (!fill(timeout_ms, deadline))
+      return 0;
+  }
+}
+
+} // namespace socket
+} // namespace wrapper
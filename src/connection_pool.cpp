@@ -0,0 +1,108 @@
+#include "socket/connection_pool.hpp"
+
+namespace wrapper {
+namespace socket {
+
+ConnectionPool::Lease::Lease(ConnectionPool* pool, std::unique_ptr<Bidirectional> connection) :
+    pool(pool), connection(std::move(connection)), reusable(true) {}
+
+ConnectionPool::Lease::Lease(Lease&& o) : pool(o.pool), connection(std::move(o.connection)),
+    reusable(o.reusable) {}
+
+ConnectionPool::Lease::~Lease(void) {
+  if (connection)
+    pool->release(std::move(connection), reusable);
+}
+
+ConnectionPool::Lease::operator bool(void) const noexcept {
+  return connection != nullptr;
+}
+
+Bidirectional& ConnectionPool::Lease::operator*(void) const noexcept {
+  return *connection;
+}
+
+Bidirectional* ConnectionPool::Lease::operator->(void) const noexcept {
+  return connection.get();
+}
+
+void ConnectionPool::Lease::discard(void) noexcept {
+  reusable = false;
+}
+
+ConnectionPool::ConnectionPool(size_t max_per_peer) : max_per_peer(max_per_peer) {
+  if (max_per_peer == 0)
+    throw std::invalid_argument("pool needs room for at least one socket per peer");
+}
+
+ConnectionPool::~ConnectionPool(void) {}
+
+ConnectionPool::Lease ConnectionPool::acquire(const Address& peer, int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex);
+  Peer& p = peers[peer];
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+  while (true) {
+    while (!p.idle.empty()) {
+      std::unique_ptr<Bidirectional> connection(std::move(p.idle.back()));
+      p.idle.pop_back();
+      // An idle socket should have nothing to read, readable means the peer closed it.
+      bool readable;
+      try {
+        readable = connection->data_available();
+      } catch (...) {
+        p.open--; // the socket is dropped, give its slot back
+        p.released.notify_one();
+        throw;
+      }
+      if (!readable)
+        return Lease(this, std::move(connection));
+      p.open--;
+    }
+    if (p.open < max_per_peer)
+      break;
+    if (timeout_ms == -1)
+      p.released.wait(lock);
+    else if (p.released.wait_until(lock, deadline) == std::cv_status::timeout &&
+        p.idle.empty() && p.open >= max_per_peer)
+      return Lease(this, nullptr);
+  }
+  p.open++; // reserve the slot while connecting without the lock
+  lock.unlock();
+  try {
+    return Lease(this, std::make_unique<Bidirectional>(peer));
+  } catch (...) {
+    lock.lock();
+    p.open--;
+    p.released.notify_one();
+    throw;
+  }
+}
+
+void ConnectionPool::release(std::unique_ptr<Bidirectional> connection, bool reusable) {
+  std::unique_ptr<Bidirectional> closed; // closed once the lock is released
+  std::lock_guard<std::mutex> lock(mutex);
+  Peer& p = peers.at(connection->get_listening_address());
+  if (reusable) {
+    p.idle.push_back(std::move(connection));
+  } else {
+    closed = std::move(connection);
+    p.open--;
+  }
+  p.released.notify_one();
+}
+
+size_t ConnectionPool::idle(const Address& peer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = peers.find(peer);
+  return it == peers.end() ? 0 : it->second.idle.size();
+}
+
+size_t ConnectionPool::open(const Address& peer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = peers.find(peer);
+  return it == peers.end() ? 0 : it->second.open;
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,68 @@
+#include "socket/connection_slab.hpp"
+
+#include <new>
+
+namespace wrapper {
+namespace socket {
+
+void ConnectionSlab::Releaser::operator()(Bidirectional* connection) const noexcept {
+  slab->release(connection);
+}
+
+ConnectionSlab::ConnectionSlab(size_t capacity) : slots(std::make_unique<Slot[]>(capacity)),
+    capacity(capacity), free_slots(nullptr), used(0) {
+  for (size_t i = capacity; i > 0; i--) {
+    slots[i - 1].next = free_slots;
+    free_slots = &slots[i - 1];
+  }
+}
+
+ConnectionSlab::~ConnectionSlab(void) {
+  if (used > 0)
+    std::cerr << "WARNING: connection slab destroyed with " << used << " connections in use" <<
+        std::endl;
+}
+
+void ConnectionSlab::release(Bidirectional* connection) noexcept {
+  connection->~Bidirectional();
+  Slot* slot = reinterpret_cast<Slot*>(connection);
+  slot->next = free_slots;
+  free_slots = slot;
+  used--;
+}
+
+ConnectionSlab::Connection ConnectionSlab::accept(Listening& listener, int timeout_ms,
+    bool nonblocking) {
+  if (!free_slots || !listener.wait(POLLIN, timeout_ms))
+    return Connection();
+  Address peer;
+  int fd = listener.accept_fd(nonblocking ? SOCK_NONBLOCK : 0, peer);
+  if (fd == -1) // another thread took the connection
+    return Connection();
+  FileDescriptor accepted(fd);
+  Address output(listener.prepare_accepted(fd));
+  Slot* slot = free_slots;
+  free_slots = slot->next;
+  Bidirectional* connection;
+  try {
+    connection = new (slot->storage) Bidirectional(listener.address, std::move(accepted), peer,
+        output, nonblocking);
+  } catch (...) {
+    slot->next = free_slots;
+    free_slots = slot;
+    throw;
+  }
+  used++;
+  return Connection(connection, Releaser(this));
+}
+
+size_t ConnectionSlab::size(void) const noexcept {
+  return used;
+}
+
+size_t ConnectionSlab::get_capacity(void) const noexcept {
+  return capacity;
+}
+
+} // namespace socket
+} // namespace wrapper
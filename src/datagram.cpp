@@ -0,0 +1,138 @@
+#include "socket/datagram.hpp"
+
+#include <netinet/udp.h>
+
+namespace wrapper {
+namespace socket {
+
+void Datagram::Batch::prepare(size_t count, size_t control_size) {
+  if (headers.size() < count) {
+    headers.resize(count);
+    iovecs.resize(count);
+    addresses.resize(count);
+  }
+  if (control.size() < count * control_size)
+    control.resize(count * control_size);
+  for (size_t i = 0; i < count; i++) {
+    headers[i].msg_hdr = msghdr{};
+    headers[i].msg_hdr.msg_name = &addresses[i];
+    headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+    headers[i].msg_hdr.msg_iov = &iovecs[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+    if (control_size) {
+      headers[i].msg_hdr.msg_control = &control[i * control_size];
+      headers[i].msg_hdr.msg_controllen = control_size;
+    }
+  }
+}
+
+Datagram::Datagram(unsigned short port) : Base(AF_INET, SOCK_DGRAM), address{get_my_ip(), port},
+    gro(false) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = INADDR_ANY;
+  if (bind(sockfd.get(), (sockaddr*) &addr, sizeof(sockaddr_in)) == -1)
+    throw std::system_error(errno, std::generic_category(), "socket bind failed");
+  if (port == 0) { // find out which port was picked
+    socklen_t addr_size = sizeof(sockaddr_in);
+    if (getsockname(sockfd.get(), (sockaddr*) &addr, &addr_size) == -1)
+      throw std::system_error(errno, std::generic_category(), "getsockname failed");
+    address = Address(address.ip(), ntohs(addr.sin_port));
+  }
+}
+
+Datagram::Datagram(Datagram&& o) : Base(std::move(o)), address(o.address), gro(o.gro),
+    receiving(std::move(o.receiving)), sending(std::move(o.sending)) {}
+
+bool Datagram::enable_gro(void) {
+  int value = 1;
+  if (setsockopt(sockfd.get(), SOL_UDP, UDP_GRO, &value, sizeof(int)) == -1) {
+    if (errno == ENOPROTOOPT || errno == EINVAL)
+      return false;
+    throw std::system_error(errno, std::generic_category(), "socket setsockopt failed");
+  }
+  gro = true;
+  return true;
+}
+
+size_t Datagram::recv_batch(Message* messages, size_t count, int timeout_ms) {
+  if (count == 0)
+    return 0;
+  size_t control_size = gro ? CMSG_SPACE(sizeof(int)) : 0;
+  receiving.prepare(count, control_size);
+  for (size_t i = 0; i < count; i++)
+    receiving.iovecs[i] = iovec{messages[i].buf, messages[i].size};
+  // Block for the first datagram only, then take whatever else is already queued.
+  int flags = timeout_ms == -1 ? MSG_WAITFORONE : MSG_DONTWAIT;
+  // The timeout covers the whole call, not each wait.
+  std::chrono::steady_clock::time_point deadline;
+  if (timeout_ms > 0)
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  int ret;
+  while ((ret = recvmmsg(sockfd.get(), receiving.headers.data(), count, flags, nullptr)) == -1) {
+    if (errno == EINTR)
+      continue;
+    if (errno != EAGAIN)
+      throw std::system_error(errno, std::generic_category(), "socket recvmmsg failed");
+    int remaining_ms = timeout_ms;
+    if (timeout_ms > 0)
+      remaining_ms = std::max<long>(0, std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+    if (!wait(POLLIN, remaining_ms))
+      return 0; // timed out
+  }
+  for (int i = 0; i < ret; i++) {
+    msghdr& msg = receiving.headers[i].msg_hdr;
+    messages[i].size = receiving.headers[i].msg_len;
+    messages[i].address = Address((sockaddr*) &receiving.addresses[i], msg.msg_namelen);
+    messages[i].segment_size = 0;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+        int segment_size;
+        std::memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(int));
+        messages[i].segment_size = segment_size;
+      }
+    }
+  }
+  return ret;
+}
+
+void Datagram::send_batch(const Message* messages, size_t count) {
+  bool segmented = std::any_of(messages, messages + count,
+      [] (const Message& m) { return m.segment_size != 0; });
+  size_t control_size = segmented ? CMSG_SPACE(sizeof(uint16_t)) : 0;
+  sending.prepare(count, control_size);
+  for (size_t i = 0; i < count; i++) {
+    sending.iovecs[i] = iovec{messages[i].buf, messages[i].size};
+    msghdr& msg = sending.headers[i].msg_hdr;
+    msg.msg_name = const_cast<sockaddr*>(messages[i].address.get_sockaddr());
+    msg.msg_namelen = messages[i].address.get_sockaddr_size();
+    if (messages[i].segment_size == 0) {
+      msg.msg_control = nullptr;
+      msg.msg_controllen = 0;
+      continue;
+    }
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    std::memcpy(CMSG_DATA(cmsg), &messages[i].segment_size, sizeof(uint16_t));
+  }
+  size_t sent = 0;
+  while (sent < count) {
+    int ret = sendmmsg(sockfd.get(), &sending.headers[sent], count - sent, 0);
+    if (ret == -1 && errno == EINTR)
+      continue;
+    if (ret == -1)
+      throw std::system_error(errno, std::generic_category(), "socket sendmmsg failed");
+    sent += ret;
+  }
+}
+
+Address Datagram::get_address(void) const noexcept {
+  return address;
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,608 @@
+#include "socket/io_engine.hpp"
+#include "socket/reactor.hpp"
+
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <unordered_map>
+
+#ifdef SOCKET_HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+namespace wrapper {
+namespace socket {
+
+// How long a listener is left alone after an accept runs out of descriptors or memory.
+static const std::chrono::milliseconds ACCEPT_BACKOFF(100);
+
+class IoEngine::Backend {
+  protected:
+    using AcceptHandler = IoEngine::AcceptHandler;
+    using ReceiveHandler = IoEngine::ReceiveHandler;
+    using SendHandler = IoEngine::SendHandler;
+    struct Send {
+      const char* buf;
+      size_t count;
+      size_t sent;
+      SendHandler handler;
+    };
+    struct Entry;
+    struct Operation {
+      enum Type : uint8_t { ACCEPT, RECEIVE, SEND } type;
+      Entry* entry;
+    };
+    struct Entry {
+      int fd;
+      const Base* socket;
+      Connected* connection = nullptr; // set once a receive is queued
+      Bidirectional* output = nullptr; // set once a send is queued
+      Listening* listener = nullptr;
+      AcceptHandler accept;
+      ReceiveHandler receive;
+      std::deque<Send> sends;
+      bool removed = false;
+      bool resting = false; // a listener not accepting until resume
+      std::chrono::steady_clock::time_point resume;
+      uint32_t interest = 0; // epoll
+      unsigned int inflight = 0; // io_uring
+      bool sending = false;
+      std::vector<iovec> iov;
+      msghdr msg{};
+      Operation accept_op{Operation::ACCEPT, this};
+      Operation receive_op{Operation::RECEIVE, this};
+      Operation send_op{Operation::SEND, this};
+      Entry(const Base& socket) : fd(socket.sockfd.get()), socket(&socket) {}
+    };
+    std::unordered_map<int, std::unique_ptr<Entry>> entries;
+    std::vector<std::unique_ptr<Entry>> removed;
+    std::vector<Entry*> pending; // entries with queued sends to submit
+    std::vector<Entry*> resting; // listeners backing off
+    size_t completions = 0;
+
+    Entry& get_entry(const Base& socket) {
+      std::unique_ptr<Entry>& e = entries[socket.sockfd.get()];
+      if (!e)
+        e = std::make_unique<Entry>(socket);
+      return *e;
+    }
+
+    std::unique_ptr<Entry> take_entry(const Base& socket) {
+      auto it = entries.find(socket.sockfd.get());
+      if (it == entries.end())
+        throw std::invalid_argument("socket is not registered");
+      std::unique_ptr<Entry> e(std::move(it->second));
+      entries.erase(it);
+      e->removed = true;
+      pending.erase(std::remove(pending.begin(), pending.end(), e.get()), pending.end());
+      resting.erase(std::remove(resting.begin(), resting.end(), e.get()), resting.end());
+      return e;
+    }
+
+    // The connection waits in the backlog and keeps the listener readable, so accepting again
+    // right away would fail the same way until something is freed.
+    static bool out_of_resources(int error) {
+      return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+    }
+
+    void rest(Entry& e) {
+      e.resting = true;
+      e.resume = std::chrono::steady_clock::now() + ACCEPT_BACKOFF;
+      resting.push_back(&e);
+    }
+
+    // Returns the listeners whose backoff is over, to accept on again.
+    std::vector<Entry*> wake(void) {
+      std::vector<Entry*> woken;
+      auto now = std::chrono::steady_clock::now();
+      for (auto it = resting.begin(); it != resting.end();) {
+        if ((*it)->resume > now) {
+          it++;
+          continue;
+        }
+        (*it)->resting = false;
+        woken.push_back(*it);
+        it = resting.erase(it);
+      }
+      return woken;
+    }
+
+    // Shortens the timeout so that a wait ends when the first resting listener may resume.
+    int rest_timeout(int timeout_ms) const {
+      if (resting.empty())
+        return timeout_ms;
+      auto resume = (*std::min_element(resting.begin(), resting.end(),
+            [] (const Entry* a, const Entry* b) { return a->resume < b->resume; }))->resume;
+      auto left = std::chrono::ceil<std::chrono::milliseconds>(
+          resume - std::chrono::steady_clock::now()).count();
+      int wait = std::max<long>(0, left);
+      return timeout_ms == -1 ? wait : std::min(timeout_ms, wait);
+    }
+
+    // Non-blocking, like the sockets accept_batch returns.
+    static std::unique_ptr<Bidirectional> adopt(Listening& listener, int fd) {
+      return listener.adopt(FileDescriptor(fd), true);
+    }
+
+    void queue_send(Bidirectional& connection, const void* buf, size_t count,
+        SendHandler handler) {
+      Entry& e = get_entry(connection);
+      e.output = &connection;
+      if (e.sends.empty())
+        pending.push_back(&e);
+      e.sends.push_back(Send{static_cast<const char*>(buf), count, 0, std::move(handler)});
+    }
+
+    // Gathers the unsent part of every queued send into e.iov.
+    void gather(Entry& e) {
+      e.iov.clear();
+      for (const Send& s : e.sends) {
+        if (e.iov.size() == IOV_MAX)
+          break;
+        e.iov.push_back({const_cast<char*>(&s.buf[s.sent]), s.count - s.sent});
+      }
+      e.msg = msghdr{};
+      e.msg.msg_iov = e.iov.data();
+      e.msg.msg_iovlen = e.iov.size();
+    }
+
+    // Retires bytes sent from the front of the queue, calling handlers of finished sends.
+    void complete_sends(Entry& e, size_t bytes) {
+      while (!e.sends.empty() && !e.removed) {
+        Send& s = e.sends.front();
+        size_t n = std::min(bytes, s.count - s.sent);
+        s.sent += n;
+        bytes -= n;
+        if (s.sent < s.count)
+          break;
+        SendHandler handler(std::move(s.handler));
+        e.sends.pop_front();
+        completions++;
+        if (handler)
+          handler(0);
+      }
+    }
+
+    void fail_sends(Entry& e, int error) {
+      while (!e.sends.empty() && !e.removed) {
+        SendHandler handler(std::move(e.sends.front().handler));
+        e.sends.pop_front();
+        completions++;
+        if (handler)
+          handler(error);
+      }
+    }
+
+    void end_receive(Entry& e) {
+      ReceiveHandler handler(std::move(e.receive));
+      e.receive = nullptr;
+      completions++;
+      handler(nullptr, 0);
+    }
+
+  public:
+    virtual ~Backend(void) {}
+    virtual bool uses_io_uring(void) const noexcept = 0;
+    virtual void accept(Listening& listener, AcceptHandler handler) = 0;
+    virtual void receive(Connected& connection, ReceiveHandler handler) = 0;
+    virtual void send(Bidirectional& connection, const void* buf, size_t count,
+        SendHandler handler) = 0;
+    virtual void remove(const Base& socket) = 0;
+    virtual size_t run_once(int timeout_ms) = 0;
+};
+
+namespace {
+
+class EpollBackend final : public IoEngine::Backend {
+  private:
+    Reactor reactor;
+    std::vector<char> buffer;
+
+    void update(Entry& e) {
+      if (e.removed)
+        return;
+      uint32_t interest = ((e.accept && !e.resting) || e.receive ? EPOLLIN : 0) |
+          (e.sends.empty() ? 0 : EPOLLOUT);
+      if (interest == e.interest)
+        return;
+      if (e.interest == 0) {
+        Entry* entry = &e;
+        reactor.add(*e.socket, Reactor::Handlers{
+            [this, entry] (void) { on_readable(*entry); },
+            [this, entry] (void) { flush(*entry); update(*entry); },
+            [this, entry] (void) { on_hangup(*entry); }}, interest);
+      } else if (interest == 0) {
+        reactor.remove(*e.socket);
+      } else {
+        reactor.modify(*e.socket, interest);
+      }
+      e.interest = interest;
+    }
+
+    void on_readable(Entry& e) {
+      if (e.accept) {
+        std::vector<std::unique_ptr<Bidirectional>> accepted;
+        try {
+          accepted = e.listener->accept_batch(SIZE_MAX, 0);
+        } catch (const std::system_error& err) {
+          if (out_of_resources(err.code().value())) {
+            rest(e);
+            update(e);
+          }
+          throw;
+        }
+        for (auto& connection : accepted) {
+          if (e.removed)
+            break;
+          completions++;
+          e.accept(std::move(connection));
+        }
+      } else if (e.receive) {
+        size_t ret = 0;
+        bool ended = false;
+        try {
+          ret = e.connection->try_read(buffer.data(), buffer.size());
+        } catch (const std::system_error&) { // closed by the peer or failed
+          ended = true;
+        }
+        if (ended) {
+          end_receive(e);
+        } else if (ret > 0) {
+          completions++;
+          e.receive(buffer.data(), ret);
+        }
+      }
+      update(e);
+    }
+
+    void on_hangup(Entry& e) {
+      if (e.receive)
+        on_readable(e);
+      if (!e.removed && !e.sends.empty())
+        flush(e);
+      update(e);
+    }
+
+    void flush(Entry& e) {
+      while (!e.sends.empty() && !e.removed) {
+        gather(e);
+        size_t ret;
+        try {
+          ret = e.output->try_writev(e.iov.data(), e.iov.size());
+        } catch (const std::system_error& err) {
+          fail_sends(e, err.code().value());
+          continue;
+        }
+        if (ret == 0)
+          return;
+        complete_sends(e, ret);
+      }
+    }
+
+  public:
+    EpollBackend(size_t buffer_size) : buffer(buffer_size) {}
+
+    bool uses_io_uring(void) const noexcept override {
+      return false;
+    }
+
+    void accept(Listening& listener, AcceptHandler handler) override {
+      Entry& e = get_entry(listener);
+      e.listener = &listener;
+      e.accept = std::move(handler);
+      update(e);
+    }
+
+    void receive(Connected& connection, ReceiveHandler handler) override {
+      Entry& e = get_entry(connection);
+      e.connection = &connection;
+      e.receive = std::move(handler);
+      update(e);
+    }
+
+    void send(Bidirectional& connection, const void* buf, size_t count,
+        SendHandler handler) override {
+      queue_send(connection, buf, count, std::move(handler));
+    }
+
+    void remove(const Base& socket) override {
+      std::unique_ptr<Entry> e(take_entry(socket));
+      if (e->interest)
+        reactor.remove(socket);
+      removed.push_back(std::move(e));
+    }
+
+    size_t run_once(int timeout_ms) override {
+      completions = 0;
+      // Try queued sends first; only what the socket buffer cannot take waits for EPOLLOUT.
+      std::vector<Entry*> submit;
+      submit.swap(pending);
+      for (Entry* e : submit) {
+        flush(*e);
+        update(*e);
+      }
+      for (Entry* e : wake())
+        update(*e);
+      reactor.poll(completions ? 0 : rest_timeout(timeout_ms));
+      removed.clear();
+      return completions;
+    }
+};
+
+#ifdef SOCKET_HAVE_IO_URING
+class UringBackend final : public IoEngine::Backend {
+  private:
+    static const int BUFFER_GROUP = 0;
+    io_uring ring;
+    io_uring_buf_ring* buffers;
+    unsigned int buffer_count;
+    size_t buffer_size;
+    std::unique_ptr<char[]> buffer_memory;
+
+    io_uring_sqe* get_sqe(void) {
+      io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+      if (!sqe) { // submission queue full, hand it to the kernel and retry
+        io_uring_submit(&ring);
+        sqe = io_uring_get_sqe(&ring);
+        if (!sqe)
+          throw std::runtime_error("io_uring submission queue full");
+      }
+      return sqe;
+    }
+
+    void recycle(unsigned short bid) {
+      io_uring_buf_ring_add(buffers, &buffer_memory[bid * buffer_size], buffer_size, bid,
+          io_uring_buf_ring_mask(buffer_count), 0);
+      io_uring_buf_ring_advance(buffers, 1);
+    }
+
+    void arm_accept(Entry& e) {
+      io_uring_sqe* sqe = get_sqe();
+      io_uring_prep_multishot_accept(sqe, e.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      io_uring_sqe_set_data(sqe, &e.accept_op);
+      e.inflight++;
+    }
+
+    void arm_receive(Entry& e) {
+      io_uring_sqe* sqe = get_sqe();
+      io_uring_prep_recv_multishot(sqe, e.fd, nullptr, 0, 0);
+      sqe->flags |= IOSQE_BUFFER_SELECT;
+      sqe->buf_group = BUFFER_GROUP;
+      io_uring_sqe_set_data(sqe, &e.receive_op);
+      e.inflight++;
+    }
+
+    // All queued sends of a socket go out as one sendmsg, so they stay in order without links.
+    void arm_send(Entry& e) {
+      gather(e);
+      io_uring_sqe* sqe = get_sqe();
+      io_uring_prep_sendmsg(sqe, e.fd, &e.msg, MSG_NOSIGNAL | MSG_WAITALL);
+      io_uring_sqe_set_data(sqe, &e.send_op);
+      e.sending = true;
+      e.inflight++;
+    }
+
+    // Puts a provided buffer back even if the receive handler throws.
+    struct Recycle {
+      UringBackend* backend;
+      unsigned short bid;
+      ~Recycle(void) { backend->recycle(bid); }
+    };
+
+    // Operations are re-armed before handlers run, so a handler that throws does not stop the
+    // socket.
+    void complete(Operation& op, int res, unsigned int flags) {
+      Entry& e = *op.entry;
+      bool more = flags & IORING_CQE_F_MORE;
+      if (!more)
+        e.inflight--;
+      switch (op.type) {
+        case Operation::ACCEPT:
+          if (!more && !e.removed && res < 0 && out_of_resources(-res))
+            rest(e); // re-armed by run_once once the backoff is over
+          else if (!more && !e.removed)
+            arm_accept(e);
+          if (res >= 0 && e.removed) { // the listener may already be gone
+            ::close(res);
+          } else if (res >= 0) {
+            std::unique_ptr<Bidirectional> connection(adopt(*e.listener, res));
+            completions++;
+            e.accept(std::move(connection));
+          } else if (res != -ECONNABORTED && res != -EINTR && !e.removed) {
+            throw std::system_error(-res, std::generic_category(), "socket accept failed");
+          }
+          break;
+        case Operation::RECEIVE: {
+          bool ended = res <= 0 && res != -ENOBUFS; // end of stream or error
+          if (!more && !ended && !e.removed && e.receive)
+            arm_receive(e); // ran out of buffers or the kernel ended the multishot
+          if (res > 0) {
+            Recycle guard{this, static_cast<unsigned short>(flags >> IORING_CQE_BUFFER_SHIFT)};
+            if (!e.removed && e.receive) {
+              completions++;
+              e.receive(&buffer_memory[guard.bid * buffer_size], res);
+            }
+          } else if (ended && !e.removed && e.receive) {
+            end_receive(e);
+          }
+          break;
+        }
+        case Operation::SEND:
+          e.sending = false;
+          if (!e.removed) // run_once only resubmits if sends are left after the handlers
+            pending.push_back(&e);
+          if (res >= 0)
+            complete_sends(e, res);
+          else
+            fail_sends(e, -res);
+          break;
+      }
+    }
+
+  public:
+    UringBackend(unsigned int entries, unsigned int buffer_count, size_t buffer_size) :
+        buffer_count(buffer_count), buffer_size(buffer_size),
+        buffer_memory(std::make_unique<char[]>(buffer_count * buffer_size)) {
+      int ret = io_uring_queue_init(entries, &ring, 0);
+      if (ret < 0)
+        throw std::system_error(-ret, std::generic_category(), "io_uring_queue_init failed");
+      buffers = io_uring_setup_buf_ring(&ring, buffer_count, BUFFER_GROUP, 0, &ret);
+      if (!buffers) {
+        io_uring_queue_exit(&ring);
+        throw std::system_error(-ret, std::generic_category(), "io_uring_setup_buf_ring failed");
+      }
+      for (unsigned int bid = 0; bid < buffer_count; bid++)
+        io_uring_buf_ring_add(buffers, &buffer_memory[bid * buffer_size], buffer_size, bid,
+            io_uring_buf_ring_mask(buffer_count), bid);
+      io_uring_buf_ring_advance(buffers, buffer_count);
+    }
+
+    ~UringBackend(void) {
+      io_uring_free_buf_ring(&ring, buffers, buffer_count, BUFFER_GROUP);
+      io_uring_queue_exit(&ring);
+    }
+
+    bool uses_io_uring(void) const noexcept override {
+      return true;
+    }
+
+    void accept(Listening& listener, AcceptHandler handler) override {
+      Entry& e = get_entry(listener);
+      bool armed = static_cast<bool>(e.accept);
+      e.listener = &listener;
+      e.accept = std::move(handler);
+      if (!armed)
+        arm_accept(e);
+    }
+
+    void receive(Connected& connection, ReceiveHandler handler) override {
+      Entry& e = get_entry(connection);
+      e.connection = &connection;
+      bool armed = static_cast<bool>(e.receive);
+      e.receive = std::move(handler);
+      if (!armed)
+        arm_receive(e);
+    }
+
+    void send(Bidirectional& connection, const void* buf, size_t count,
+        SendHandler handler) override {
+      queue_send(connection, buf, count, std::move(handler));
+    }
+
+    void remove(const Base& socket) override {
+      std::unique_ptr<Entry> e(take_entry(socket));
+      if (e->inflight) {
+        // The cancel is submitted right away, while the descriptor still names this socket, but
+        // completes asynchronously. The entry is kept until its last operation completes, and
+        // the kernel holds its own reference to the file, so the socket may be closed at once.
+        io_uring_sqe* sqe = get_sqe();
+        io_uring_prep_cancel_fd(sqe, e->fd, IORING_ASYNC_CANCEL_ALL);
+        io_uring_sqe_set_data(sqe, nullptr);
+        io_uring_submit(&ring);
+      }
+      removed.push_back(std::move(e));
+    }
+
+    size_t run_once(int timeout_ms) override {
+      completions = 0;
+      std::vector<Entry*> submit;
+      submit.swap(pending);
+      for (Entry* e : submit)
+        if (!e->removed && !e->sending && !e->sends.empty())
+          arm_send(*e);
+      for (Entry* e : wake())
+        arm_accept(*e);
+      timeout_ms = rest_timeout(timeout_ms);
+      int ret;
+      io_uring_cqe* cqe;
+      if (timeout_ms == -1) {
+        ret = io_uring_submit_and_wait(&ring, 1);
+      } else {
+        __kernel_timespec ts{timeout_ms / 1000, (timeout_ms % 1000) * 1000000LL};
+        ret = io_uring_submit_and_wait_timeout(&ring, &cqe, 1, &ts, nullptr);
+      }
+      if (ret < 0 && ret != -ETIME && ret != -EINTR)
+        throw std::system_error(-ret, std::generic_category(), "io_uring submit failed");
+      // Copy the batch out of the ring before running handlers, which may queue more work.
+      struct Completion {
+        Operation* op;
+        int res;
+        unsigned int flags;
+      };
+      std::vector<Completion> batch;
+      unsigned int head;
+      io_uring_for_each_cqe(&ring, head, cqe)
+        batch.push_back({static_cast<Operation*>(io_uring_cqe_get_data(cqe)), cqe->res,
+            cqe->flags});
+      io_uring_cq_advance(&ring, batch.size());
+      // Every completion is handled even if one throws, so that no provided buffer or in-flight
+      // count is lost. The first exception is rethrown afterwards.
+      std::exception_ptr error;
+      for (const Completion& c : batch) {
+        if (!c.op) // cancellations carry no operation
+          continue;
+        try {
+          complete(*c.op, c.res, c.flags);
+        } catch (...) {
+          if (!error)
+            error = std::current_exception();
+        }
+      }
+      removed.erase(std::remove_if(removed.begin(), removed.end(),
+            [] (const std::unique_ptr<Entry>& e) { return e->inflight == 0; }), removed.end());
+      if (error)
+        std::rethrow_exception(error);
+      return completions;
+    }
+};
+#endif
+
+} // namespace
+
+IoEngine::IoEngine(unsigned int entries, unsigned int buffer_count, size_t buffer_size) {
+  if (buffer_count == 0 || (buffer_count & (buffer_count - 1)) || buffer_count > 32768)
+    throw std::invalid_argument("buffer count must be a power of two no larger than 32768");
+  if (buffer_size == 0)
+    throw std::invalid_argument("buffer size must be positive");
+#ifdef SOCKET_HAVE_IO_URING
+  try {
+    backend = std::make_unique<UringBackend>(entries, buffer_count, buffer_size);
+  } catch (const std::system_error& e) { // kernel too old or io_uring disabled
+    backend = std::make_unique<EpollBackend>(buffer_size);
+  }
+#else
+  backend = std::make_unique<EpollBackend>(buffer_size);
+#endif
+}
+
+IoEngine::IoEngine(IoEngine&& o) : backend(std::move(o.backend)) {}
+
+IoEngine::~IoEngine(void) {}
+
+bool IoEngine::uses_io_uring(void) const noexcept {
+  return backend->uses_io_uring();
+}
+
+void IoEngine::accept(Listening& listener, AcceptHandler handler) {
+  backend->accept(listener, std::move(handler));
+}
+
+void IoEngine::receive(Connected& connection, ReceiveHandler handler) {
+  backend->receive(connection, std::move(handler));
+}
+
+void IoEngine::send(Bidirectional& connection, const void* buf, size_t count,
+    SendHandler handler) {
+  backend->send(connection, buf, count, std::move(handler));
+}
+
+void IoEngine::remove(const Base& socket) {
+  backend->remove(socket);
+}
+
+size_t IoEngine::run_once(int timeout_ms) {
+  return backend->run_once(timeout_ms);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,58 @@
+#include "socket/listening_group.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace wrapper {
+namespace socket {
+
+ListeningGroup::ListeningGroup(unsigned short port, size_t size, SocketOptions options) {
+  if (size == 0)
+    throw std::invalid_argument("listening group needs at least one listener");
+  options.reuse_port = true;
+  listeners.reserve(size);
+  for (size_t i = 0; i < size; i++)
+    listeners.emplace_back(port, options);
+}
+
+ListeningGroup::ListeningGroup(ListeningGroup&& o) : listeners(std::move(o.listeners)) {}
+
+size_t ListeningGroup::size(void) const noexcept {
+  return listeners.size();
+}
+
+Listening& ListeningGroup::operator[](size_t i) {
+  return listeners.at(i);
+}
+
+Address ListeningGroup::get_address(void) const noexcept {
+  return listeners.front().get_address();
+}
+
+void ListeningGroup::pin(size_t i) {
+  Listening& listener = listeners.at(i);
+  int cpu = pin_thread(i);
+  if (setsockopt(listener.sockfd.get(), SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(int)) == -1)
+    throw std::system_error(errno, std::generic_category(), "socket setsockopt failed");
+}
+
+int pin_thread(size_t i) {
+  cpu_set_t allowed;
+  int ret = pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &allowed);
+  if (ret != 0)
+    throw std::system_error(ret, std::generic_category(), "pthread_getaffinity_np failed");
+  i %= CPU_COUNT(&allowed); // never empty for a running thread
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed) || i-- > 0)
+    cpu++;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+  if (ret != 0)
+    throw std::system_error(ret, std::generic_category(), "pthread_setaffinity_np failed");
+  return cpu;
+}
+
+} // namespace socket
+} // namespace wrapper
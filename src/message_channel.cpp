@@ -0,0 +1,51 @@
+#include "socket/message_channel.hpp"
+
+namespace wrapper {
+namespace socket {
+
+MessageChannel::MessageChannel(Bidirectional& connection, BufferPool& pool,
+    uint32_t max_frame_size, size_t read_capacity) : connection(connection),
+    reader(connection, read_capacity), pool(pool), max_frame_size(max_frame_size) {
+  if (read_capacity < sizeof(uint32_t))
+    throw std::invalid_argument("read buffer cannot hold a frame header");
+}
+
+MessageChannel::MessageChannel(MessageChannel&& o) : connection(o.connection),
+    reader(std::move(o.reader)), pool(o.pool), max_frame_size(o.max_frame_size) {}
+
+void MessageChannel::send(const void* buf, uint32_t count) {
+  if (count > max_frame_size)
+    throw std::length_error("frame larger than the maximum frame size");
+  uint32_t header = htonl(count);
+  iovec iov[2] = {{&header, sizeof(uint32_t)}, {const_cast<void*>(buf), count}};
+  connection.writev(iov, 2);
+}
+
+BufferPool::Buffer MessageChannel::receive(int timeout_ms) {
+  std::chrono::steady_clock::time_point deadline;
+  if (timeout_ms > 0)
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  uint32_t header;
+  if (!reader.peek(&header, sizeof(uint32_t), timeout_ms))
+    return BufferPool::Buffer();
+  uint32_t count = ntohl(header);
+  if (count > max_frame_size)
+    throw std::length_error("received frame larger than the maximum frame size");
+  size_t frame_size = sizeof(uint32_t) + count;
+  if (frame_size <= reader.get_capacity()) {
+    // Consume nothing until the whole frame is buffered, so a timeout loses nothing.
+    int remaining_ms = timeout_ms;
+    if (timeout_ms > 0)
+      remaining_ms = std::max<long>(0, std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+    if (!reader.ensure(frame_size, remaining_ms))
+      return BufferPool::Buffer();
+  }
+  BufferPool::Buffer message(pool.get(count));
+  reader.read_exact(&header, sizeof(uint32_t));
+  reader.read_exact(message.data(), count);
+  return message;
+}
+
+} // namespace socket
+} // namespace wrapper
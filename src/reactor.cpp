@@ -0,0 +1,114 @@
+#include "socket/reactor.hpp"
+
+#include <exception>
+
+namespace wrapper {
+namespace socket {
+
+static uint32_t epoll_events(uint32_t events, bool edge_triggered) {
+  return events | EPOLLRDHUP | (edge_triggered ? EPOLLET : 0);
+}
+
+Reactor::Reactor(size_t max_events) : epfd(epoll_create1(EPOLL_CLOEXEC)), events(max_events) {
+  if (epfd == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll create failed");
+  if (max_events == 0)
+    throw std::invalid_argument("reactor needs room for at least one event");
+}
+
+Reactor::Reactor(Reactor&& o) : epfd(std::move(o.epfd)), events(std::move(o.events)),
+    registrations(std::move(o.registrations)), removed(std::move(o.removed)) {}
+
+Reactor::~Reactor(void) {}
+
+void Reactor::add(const Base& socket, Handlers handlers, uint32_t interest, bool edge_triggered) {
+  add(socket.sockfd.get(), std::move(handlers), interest, edge_triggered);
+}
+
+void Reactor::add(int fd, Handlers handlers, uint32_t interest, bool edge_triggered) {
+  if (registrations.count(fd))
+    throw std::invalid_argument("socket is already registered");
+  std::unique_ptr<Registration> registration(
+      std::make_unique<Registration>(Registration{fd, std::move(handlers)}));
+  epoll_event ev;
+  ev.events = epoll_events(interest, edge_triggered);
+  ev.data.ptr = registration.get();
+  if (epoll_ctl(epfd.get(), EPOLL_CTL_ADD, fd, &ev) == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll_ctl failed");
+  registrations.emplace(fd, std::move(registration));
+}
+
+void Reactor::modify(const Base& socket, uint32_t interest, bool edge_triggered) {
+  modify(socket.sockfd.get(), interest, edge_triggered);
+}
+
+void Reactor::modify(int fd, uint32_t interest, bool edge_triggered) {
+  auto it = registrations.find(fd);
+  if (it == registrations.end())
+    throw std::invalid_argument("socket is not registered");
+  epoll_event ev;
+  ev.events = epoll_events(interest, edge_triggered);
+  ev.data.ptr = it->second.get();
+  if (epoll_ctl(epfd.get(), EPOLL_CTL_MOD, fd, &ev) == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll_ctl failed");
+}
+
+void Reactor::remove(const Base& socket) {
+  remove(socket.sockfd.get());
+}
+
+void Reactor::remove(int fd) {
+  auto it = registrations.find(fd);
+  if (it == registrations.end())
+    throw std::invalid_argument("socket is not registered");
+  if (epoll_ctl(epfd.get(), EPOLL_CTL_DEL, fd, nullptr) == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll_ctl failed");
+  // Events for this socket may still be pending in the current batch.
+  it->second->fd = -1;
+  removed.push_back(std::move(it->second));
+  registrations.erase(it);
+}
+
+size_t Reactor::size(void) const noexcept {
+  return registrations.size();
+}
+
+size_t Reactor::poll(int timeout_ms) {
+  int ret = epoll_wait(epfd.get(), events.data(), events.size(), timeout_ms);
+  if ((ret == -1 && errno == EINTR) || ret == 0) // interrupted or timeout
+    return 0;
+  if (ret == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll wait failed");
+  // The whole batch is dispatched even if a handler throws, since an edge-triggered socket left
+  // out would not be reported again. The first exception is rethrown afterwards.
+  std::exception_ptr error;
+  auto call = [&error] (const std::function<void(void)>& handler) {
+        try {
+          handler();
+        } catch (...) {
+          if (!error)
+            error = std::current_exception();
+        }
+      };
+  for (int i = 0; i < ret; i++) {
+    Registration* registration = static_cast<Registration*>(events[i].data.ptr);
+    uint32_t ready = events[i].events;
+    if (registration->fd != -1 && ready & EPOLLIN && registration->handlers.read)
+      call(registration->handlers.read);
+    if (registration->fd != -1 && ready & EPOLLOUT && registration->handlers.write)
+      call(registration->handlers.write);
+    if (registration->fd != -1 && ready & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) {
+      if (registration->handlers.hangup)
+        call(registration->handlers.hangup);
+      else if (!(ready & EPOLLIN) && registration->handlers.read)
+        call(registration->handlers.read); // let the reader observe end of stream
+    }
+  }
+  removed.clear();
+  if (error)
+    std::rethrow_exception(error);
+  return ret;
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,212 @@
+#include "socket/scheduler.hpp"
+
+#ifdef __cpp_impl_coroutine
+namespace wrapper {
+namespace socket {
+
+Scheduler::Task::promise_type::~promise_type(void) {
+  if (scheduler)
+    scheduler->tasks--;
+}
+
+Scheduler::Task Scheduler::Task::promise_type::get_return_object(void) noexcept {
+  return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+void Scheduler::Task::promise_type::unhandled_exception(void) noexcept {
+  if (!scheduler->failure)
+    scheduler->failure = std::current_exception();
+}
+
+Scheduler::Task::Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+Scheduler::Task::Task(Task&& o) : handle(std::exchange(o.handle, nullptr)) {}
+
+Scheduler::Task::~Task(void) {
+  if (handle) // never spawned
+    handle.destroy();
+}
+
+Scheduler::Operation::Operation(Scheduler& scheduler, const Base& socket, uint32_t events) :
+    scheduler(scheduler), socket(socket), events(events) {}
+
+Scheduler::Operation::~Operation(void) {}
+
+bool Scheduler::Operation::try_attempt(void) noexcept {
+  try {
+    return attempt();
+  } catch (...) {
+    error = std::current_exception(); // rethrown in the awaiting coroutine
+    return true;
+  }
+}
+
+void Scheduler::Operation::rethrow(void) const {
+  if (error)
+    std::rethrow_exception(error);
+}
+
+bool Scheduler::Operation::await_ready(void) noexcept {
+  return try_attempt();
+}
+
+void Scheduler::Operation::await_suspend(std::coroutine_handle<> handle) {
+  waiting = handle;
+  scheduler.wait(*this);
+}
+
+Scheduler::Scheduler(size_t max_events) : reactor(max_events), tasks(0) {}
+
+Scheduler::~Scheduler(void) {
+  std::vector<std::coroutine_handle<>> suspended;
+  for (auto& w : waiting) {
+    if (w.second.read)
+      suspended.push_back(w.second.read->waiting);
+    if (w.second.write)
+      suspended.push_back(w.second.write->waiting);
+    reactor.remove(*w.first);
+  }
+  waiting.clear();
+  for (auto& handle : suspended)
+    handle.destroy();
+}
+
+void Scheduler::wait(Operation& operation) {
+  auto it = waiting.find(&operation.socket);
+  bool registered = it != waiting.end();
+  if (!registered)
+    it = waiting.emplace(&operation.socket, Waiters{}).first;
+  Operation*& slot = operation.events == EPOLLIN ? it->second.read : it->second.write;
+  if (slot)
+    throw std::logic_error("socket already has an operation waiting in this direction");
+  slot = &operation;
+  uint32_t interest = (it->second.read ? EPOLLIN : 0) | (it->second.write ? EPOLLOUT : 0);
+  if (registered) {
+    reactor.modify(operation.socket, interest);
+    return;
+  }
+  const Base* socket = &operation.socket;
+  reactor.add(operation.socket, Reactor::Handlers{
+        [this, socket] (void) { wake(socket, EPOLLIN); },
+        [this, socket] (void) { wake(socket, EPOLLOUT); },
+        [this, socket] (void) { wake(socket, EPOLLIN | EPOLLOUT); }}, interest);
+}
+
+void Scheduler::wake(const Base* socket, uint32_t events) {
+  auto it = waiting.find(socket);
+  if (it == waiting.end())
+    return;
+  std::coroutine_handle<> ready[2];
+  size_t n_ready = 0;
+  if (events & EPOLLIN && it->second.read && it->second.read->try_attempt())
+    ready[n_ready++] = std::exchange(it->second.read, nullptr)->waiting;
+  if (events & EPOLLOUT && it->second.write && it->second.write->try_attempt())
+    ready[n_ready++] = std::exchange(it->second.write, nullptr)->waiting;
+  if (n_ready == 0)
+    return;
+  // Deregister before resuming, the coroutine may destroy the socket.
+  if (!it->second.read && !it->second.write) {
+    waiting.erase(it);
+    reactor.remove(*socket);
+  } else {
+    reactor.modify(*socket, it->second.read ? EPOLLIN : EPOLLOUT);
+  }
+  for (size_t i = 0; i < n_ready; i++)
+    ready[i].resume();
+}
+
+void Scheduler::rethrow_failure(void) {
+  if (failure)
+    std::rethrow_exception(std::exchange(failure, nullptr));
+}
+
+void Scheduler::spawn(Task task) {
+  std::coroutine_handle<Task::promise_type> handle = std::exchange(task.handle, nullptr);
+  handle.promise().scheduler = this;
+  tasks++;
+  handle.resume();
+  rethrow_failure();
+}
+
+size_t Scheduler::size(void) const noexcept {
+  return tasks;
+}
+
+size_t Scheduler::run_once(int timeout_ms) {
+  size_t ready = reactor.poll(timeout_ms);
+  rethrow_failure();
+  return ready;
+}
+
+void Scheduler::run(void) {
+  while (tasks > 0)
+    run_once(-1);
+}
+
+AsyncAccept::AsyncAccept(Scheduler& scheduler, Listening& listener) :
+    Operation(scheduler, listener, EPOLLIN), listener(listener) {}
+
+bool AsyncAccept::attempt(void) {
+  connection = listener.accept_one(SOCK_NONBLOCK | SOCK_CLOEXEC);
+  return connection != nullptr; // nullptr once the backlog is drained
+}
+
+std::unique_ptr<Bidirectional> AsyncAccept::await_resume(void) {
+  rethrow();
+  return std::move(connection);
+}
+
+AsyncRead::AsyncRead(Scheduler& scheduler, Connected& connection, void* buf, size_t count) :
+    Operation(scheduler, connection, EPOLLIN), connection(connection), buf((char*) buf),
+    count(count) {}
+
+bool AsyncRead::attempt(void) {
+  while (count > 0) {
+    size_t ret = connection.try_read(buf, count);
+    if (ret == 0)
+      return false;
+    buf += ret;
+    count -= ret;
+  }
+  return true;
+}
+
+void AsyncRead::await_resume(void) const {
+  rethrow();
+}
+
+AsyncWrite::AsyncWrite(Scheduler& scheduler, Bidirectional& connection, const void* buf,
+    size_t count) : Operation(scheduler, connection, EPOLLOUT), connection(connection),
+    buf((const char*) buf), count(count) {}
+
+bool AsyncWrite::attempt(void) {
+  while (count > 0) {
+    iovec iov{const_cast<char*>(buf), count};
+    size_t ret = connection.try_writev(&iov, 1);
+    if (ret == 0)
+      return false;
+    buf += ret;
+    count -= ret;
+  }
+  return true;
+}
+
+void AsyncWrite::await_resume(void) const {
+  rethrow();
+}
+
+AsyncAccept Listening::async_accept(Scheduler& scheduler) {
+  return AsyncAccept(scheduler, *this);
+}
+
+AsyncRead Connected::async_read(Scheduler& scheduler, void* buf, size_t count) {
+  return AsyncRead(scheduler, *this, buf, count);
+}
+
+AsyncWrite Bidirectional::async_write(Scheduler& scheduler, const void* buf, size_t count) {
+  return AsyncWrite(scheduler, *this, buf, count);
+}
+
+} // namespace socket
+} // namespace wrapper
+#endif
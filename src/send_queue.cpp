@@ -0,0 +1,89 @@
+#include "socket/send_queue.hpp"
+
+#include <new>
+
+namespace wrapper {
+namespace socket {
+
+SendQueue::SendQueue(Bidirectional& connection) : connection(connection), head(nullptr),
+    flushing(false) {}
+
+SendQueue::~SendQueue(void) {
+  try {
+    flush();
+  } catch (const std::exception& e) {
+    std::cerr << "WARNING: send queue flush failed: " << e.what() << std::endl;
+  }
+  destroy(head.exchange(nullptr));
+}
+
+void SendQueue::destroy(Node* node) noexcept {
+  while (node) {
+    Node* next = node->next;
+    ::operator delete(node);
+    node = next;
+  }
+}
+
+void SendQueue::send(const void* buf, size_t count) {
+  bool flusher = !flushing.exchange(true);
+  if (flusher && head.load() == nullptr) {
+    // Nothing is queued, so the buffer is written in place without being copied.
+    try {
+      connection.write(buf, count);
+    } catch (...) {
+      flushing = false;
+      throw;
+    }
+    flushing = false;
+    if (head.load() != nullptr)
+      flush();
+    return;
+  }
+  if (flusher)
+    flushing = false;
+  push(buf, count);
+  flush();
+}
+
+void SendQueue::push(const void* buf, size_t count) {
+  // The header and the data share one allocation.
+  Node* node = static_cast<Node*>(::operator new(sizeof(Node) + count));
+  node->size = count;
+  std::memcpy(node->data(), buf, count);
+  node->next = head.load(std::memory_order_relaxed);
+  while (!head.compare_exchange_weak(node->next, node)) {}
+}
+
+bool SendQueue::flush(void) {
+  // The push and the exchange of flushing in producers, and the release of flushing and the
+  // load of head below, are sequentially consistent: either a producer becomes the flusher or
+  // the flusher sees its buffer after releasing, so no buffer is left behind.
+  do {
+    if (flushing.exchange(true))
+      return false;
+    Node* batch = head.exchange(nullptr);
+    std::vector<iovec> iov;
+    for (Node* node = batch; node; node = node->next)
+      iov.push_back({node->data(), node->size});
+    std::reverse(iov.begin(), iov.end()); // oldest first
+    try {
+      if (!iov.empty())
+        connection.writev(iov.data(), iov.size());
+    } catch (...) {
+      destroy(batch);
+      flushing = false;
+      throw;
+    }
+    destroy(batch);
+    flushing = false;
+  } while (head.load() != nullptr);
+  return true;
+}
+
+bool SendQueue::empty(void) const noexcept {
+  return head.load() == nullptr;
+}
+
+} // namespace socket
+} // namespace wrapper
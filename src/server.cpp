@@ -0,0 +1,336 @@
+#include "socket/server.hpp"
+#include "socket/listening_group.hpp"
+
+#include <sys/eventfd.h>
+
+namespace wrapper {
+namespace socket {
+
+// How long the listener is left alone after an accept runs out of descriptors or memory.
+static const std::chrono::milliseconds ACCEPT_BACKOFF(100);
+
+Server::Session::Session(Reactor& reactor, std::unique_ptr<Bidirectional> connection,
+    const ServerConfig& config) : connection(std::move(connection)),
+    output(reactor, *this->connection, WriteWatermarks{config.high_watermark,
+        config.low_watermark, [this] (void) { throttled = true; },
+        [this] (void) { throttled = false; }}) {}
+
+Server::Worker::Worker(void) : event(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), buffer(65536),
+    open(0), stopping(false) {
+  if (event == -1)
+    throw std::system_error(errno, std::generic_category(), "eventfd create failed");
+}
+
+Server::Server(const Address& address, Handler handler, const ServerConfig& config) :
+    handler(std::move(handler)), config(config), listener(address, config.options),
+    pool(std::make_unique<TaskPool>(config.pool_threads)),
+    acceptor_event(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), acceptor_stopping(false),
+    n_accepted(0) {
+  if (acceptor_event == -1)
+    throw std::system_error(errno, std::generic_category(), "eventfd create failed");
+  if (config.low_watermark > config.high_watermark)
+    throw std::invalid_argument("low watermark above the high watermark");
+  size_t n_workers = config.workers ? config.workers : std::thread::hardware_concurrency();
+  for (size_t i = 0; i < std::max<size_t>(n_workers, 1); i++) {
+    workers.push_back(std::make_unique<Worker>());
+    Worker* worker = workers.back().get();
+    worker->reactor.add(worker->event.get(),
+        Reactor::Handlers{[this, worker] (void) { drain(*worker); }, nullptr, nullptr});
+  }
+  acceptor.add(listener, Reactor::Handlers{[this] (void) { accept(); }, nullptr, nullptr});
+  acceptor.add(acceptor_event.get(), Reactor::Handlers{}); // only wakes the thread to stop
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i]->thread = std::thread(&Server::run, this, std::ref(*workers[i]), i);
+  acceptor_thread = std::thread(&Server::run_acceptor, this);
+}
+
+// As notify, but logs instead of throwing, so that the destructor still gets to join the threads.
+static void notify_stop(const FileDescriptor& event) noexcept {
+  uint64_t one = 1;
+  if (::write(event.get(), &one, sizeof(uint64_t)) == -1 && errno != EAGAIN)
+    std::cerr << "WARNING: server stop notify failed: " << std::strerror(errno) << std::endl;
+}
+
+Server::~Server(void) {
+  acceptor_stopping = true;
+  notify_stop(acceptor_event);
+  acceptor_thread.join();
+  for (auto& worker : workers) {
+    worker->stopping = true;
+    notify_stop(worker->event);
+  }
+  for (auto& worker : workers)
+    worker->thread.join();
+  // The sessions outlive the pool, so requests still running can finish.
+  pool.reset();
+}
+
+Address Server::get_address(void) const noexcept {
+  return listener.get_address();
+}
+
+size_t Server::connections(void) const noexcept {
+  size_t open = 0;
+  for (auto& worker : workers)
+    open += worker->open;
+  return open;
+}
+
+uint64_t Server::accepted(void) const noexcept {
+  return n_accepted;
+}
+
+size_t Server::get_workers(void) const noexcept {
+  return workers.size();
+}
+
+void Server::notify(const FileDescriptor& event) {
+  uint64_t one = 1;
+  if (::write(event.get(), &one, sizeof(uint64_t)) == -1 && errno != EAGAIN)
+    throw std::system_error(errno, std::generic_category(), "eventfd write failed");
+}
+
+void Server::run_acceptor(void) {
+  while (!acceptor_stopping) {
+    int timeout_ms = -1;
+    if (accept_resume) {
+      std::chrono::steady_clock::duration remaining =
+          *accept_resume - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::steady_clock::duration::zero()) {
+        accept_resume.reset();
+        acceptor.modify(listener, EPOLLIN);
+      } else {
+        timeout_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+      }
+    }
+    acceptor.poll(timeout_ms);
+  }
+}
+
+void Server::accept(void) {
+  std::vector<std::unique_ptr<Bidirectional>> accepted;
+  try {
+    accepted = listener.accept_batch(64, 0);
+  } catch (const std::system_error& e) {
+    std::cerr << "WARNING: server accept failed: " << e.what() << std::endl;
+    int error = e.code().value();
+    if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+      // The connection waits in the backlog and keeps the level-triggered listener readable,
+      // so polling it would spin until something is freed.
+      acceptor.modify(listener, 0);
+      accept_resume = std::chrono::steady_clock::now() + ACCEPT_BACKOFF;
+    }
+    return;
+  } catch (const std::exception& e) { // the connection that failed is closed
+    std::cerr << "WARNING: server accept failed: " << e.what() << std::endl;
+    return;
+  }
+  for (auto& connection : accepted) {
+    Worker* target = workers.front().get();
+    for (auto& worker : workers)
+      if (worker->open < target->open)
+        target = worker.get();
+    target->open++; // before the worker can see the connection and close it
+    try {
+      std::lock_guard<std::mutex> lock(target->mutex);
+      target->accepted.push_back(std::move(connection));
+    } catch (const std::exception& e) {
+      std::cerr << "WARNING: server hand off failed: " << e.what() << std::endl;
+      target->open--;
+      continue;
+    }
+    n_accepted++;
+    try {
+      notify(target->event);
+    } catch (const std::exception& e) { // picked up on the worker's next wakeup
+      std::cerr << "WARNING: server hand off failed: " << e.what() << std::endl;
+    }
+  }
+}
+
+// The handlers close the connection a failure was about, so what reaches here is a failure of
+// the worker's own reactor or eventfd. It is logged and the worker goes on.
+void Server::run(Worker& worker, size_t i) {
+  if (config.pin) {
+    try {
+      pin_thread(i);
+    } catch (const std::exception& e) { // an unpinned worker still works
+      std::cerr << "WARNING: server worker pin failed: " << e.what() << std::endl;
+    }
+  }
+  while (!worker.stopping) {
+    try {
+      worker.reactor.poll();
+    } catch (const std::exception& e) {
+      std::cerr << "WARNING: server worker failed: " << e.what() << std::endl;
+    }
+  }
+}
+
+void Server::drain(Worker& worker) {
+  uint64_t count;
+  if (::read(worker.event.get(), &count, sizeof(uint64_t)) == -1 && errno != EAGAIN)
+    throw std::system_error(errno, std::generic_category(), "eventfd read failed");
+  std::vector<std::unique_ptr<Bidirectional>> accepted;
+  std::vector<Session*> completed;
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    accepted.swap(worker.accepted);
+    completed.swap(worker.completed);
+  }
+  for (auto& connection : accepted) {
+    try {
+      start(worker, std::move(connection));
+    } catch (const std::exception& e) {
+      std::cerr << "WARNING: server connection start failed: " << e.what() << std::endl;
+      worker.open--;
+    }
+  }
+  for (Session* session : completed) {
+    try {
+      complete(worker, *session);
+    } catch (const std::exception& e) {
+      std::cerr << "WARNING: server request completion failed: " << e.what() << std::endl;
+      close(worker, *session);
+    }
+  }
+}
+
+void Server::start(Worker& worker, std::unique_ptr<Bidirectional> connection) {
+  auto session = std::make_unique<Session>(worker.reactor, std::move(connection), config);
+  Session* s = session.get();
+  worker.reactor.add(*s->connection, Reactor::Handlers{
+      [this, &worker, s] (void) { receive(worker, *s); },
+      [this, &worker, s] (void) { flush(worker, *s); }, nullptr});
+  worker.sessions.emplace(s, std::move(session));
+}
+
+void Server::receive(Worker& worker, Session& session) {
+  if (session.input_ended) // reported again whenever the interest set changes
+    return;
+  if (session.busy) { // only a hangup is reported while the request runs, which still completes
+    session.output.set_edge_triggered(true);
+    return;
+  }
+  size_t count;
+  try {
+    count = session.connection->try_read(worker.buffer.data(), worker.buffer.size());
+  } catch (const std::system_error& e) {
+    if (e.code().value() == ECONNRESET) // closed by the peer
+      end_input(worker, session);
+    else
+      close(worker, session);
+    return;
+  }
+  if (count == 0)
+    return;
+  if (session.input.size() + count > config.max_input) {
+    close(worker, session);
+    return;
+  }
+  try {
+    session.input.append(worker.buffer.data(), count);
+    dispatch(worker, session);
+  } catch (const std::exception& e) {
+    std::cerr << "WARNING: server request dispatch failed: " << e.what() << std::endl;
+    close(worker, session);
+  }
+}
+
+// What is queued still goes out. If the connection was reset, the next write fails and closes it.
+void Server::end_input(Worker& worker, Session& session) {
+  session.input_ended = true;
+  if (session.output.pending() == 0) {
+    close(worker, session);
+    return;
+  }
+  session.output.set_interest(0);
+  session.output.set_edge_triggered(true); // the end of input stays readable
+}
+
+// Leaves the session idle if it throws, so that it can be closed.
+void Server::dispatch(Worker& worker, Session& session) {
+  session.output.set_interest(0);
+  session.busy = true;
+  try {
+    pool->submit([this, &worker, &session] (void) {
+          try {
+            session.consumed = handler(session.input.data(), session.input.size(),
+                session.response);
+          } catch (...) {
+            session.failed = true;
+          }
+          try { // pool tasks must not throw
+            {
+              std::lock_guard<std::mutex> lock(worker.mutex);
+              worker.completed.push_back(&session);
+            }
+            notify(worker.event);
+          } catch (const std::exception& e) {
+            std::cerr << "WARNING: server request hand back failed: " << e.what() << std::endl;
+          }
+        });
+  } catch (...) {
+    session.busy = false;
+    throw;
+  }
+}
+
+void Server::complete(Worker& worker, Session& session) {
+  session.busy = false;
+  if (session.closed || session.failed) {
+    close(worker, session);
+    return;
+  }
+  session.input.erase(0, session.consumed);
+  try {
+    if (!session.response.empty())
+      session.output.write(session.response.data(), session.response.size());
+  } catch (std::system_error&) {
+    close(worker, session);
+    return;
+  }
+  session.response.clear();
+  if (!session.throttled)
+    resume(worker, session);
+}
+
+// The rest of the input may hold whole requests if the handler consumed something.
+void Server::resume(Worker& worker, Session& session) {
+  if (session.consumed > 0 && !session.input.empty())
+    dispatch(worker, session);
+  else if (!session.input_ended)
+    session.output.set_interest(EPOLLIN);
+  else if (session.output.pending() == 0)
+    close(worker, session);
+}
+
+void Server::flush(Worker& worker, Session& session) {
+  bool throttled = session.throttled;
+  try {
+    session.output.flush();
+    if (throttled && !session.throttled && !session.busy) {
+      resume(worker, session);
+      return;
+    }
+  } catch (const std::exception&) {
+    close(worker, session);
+    return;
+  }
+  if (session.input_ended && !session.busy && session.output.pending() == 0)
+    close(worker, session);
+}
+
+void Server::close(Worker& worker, Session& session) {
+  if (!session.closed) {
+    worker.reactor.remove(*session.connection);
+    session.closed = true;
+  }
+  if (session.busy) // freed when its request completes
+    return;
+  worker.open--;
+  worker.sessions.erase(&session);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -1,19 +1,63 @@
 #include "socket/socket.hpp"
 
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
+
 namespace wrapper {
 namespace socket {
 
-Base::Base(FileDescriptor&& sockfd) : sockfd(std::move(sockfd)) {}
+Base::Base(FileDescriptor&& sockfd, bool nonblocking) : sockfd(std::move(sockfd)),
+    nonblocking(nonblocking) {}
+
+static void set_option(int sockfd, int level, int name, int value) {
+  if (setsockopt(sockfd, level, name, &value, sizeof(int)) == -1)
+    throw std::system_error(errno, std::generic_category(), "socket setsockopt failed");
+}
+
+static bool is_tcp(int domain, int type) {
+  return (domain == AF_INET || domain == AF_INET6) && type == SOCK_STREAM;
+}
+
+static int get_type(const SocketOptions& options) {
+  return options.seqpacket ? SOCK_SEQPACKET : SOCK_STREAM;
+}
+
+// Options shared by every kind of socket, the listener-only ones are set by Listening.
+static void apply_options(int sockfd, int domain, int type, const SocketOptions& options) {
+  if (options.reuse_port)
+    set_option(sockfd, SOL_SOCKET, SO_REUSEPORT, 1);
+  if (options.send_buffer)
+    set_option(sockfd, SOL_SOCKET, SO_SNDBUF, options.send_buffer);
+  if (options.receive_buffer)
+    set_option(sockfd, SOL_SOCKET, SO_RCVBUF, options.receive_buffer);
+  if (options.busy_poll_us)
+    set_option(sockfd, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll_us);
+  if (!is_tcp(domain, type))
+    return;
+  if (options.reuse_address)
+    set_option(sockfd, SOL_SOCKET, SO_REUSEADDR, 1);
+  if (options.no_delay)
+    set_option(sockfd, IPPROTO_TCP, TCP_NODELAY, 1);
+  if (options.quick_ack)
+    set_option(sockfd, IPPROTO_TCP, TCP_QUICKACK, 1);
+}
 
-Base::Base(void) : Base(::socket(AF_INET, SOCK_STREAM, 0)) {
+Base::Base(int domain, int type, const SocketOptions& options) :
+    Base(FileDescriptor(::socket(domain, type, 0))) {
   if (sockfd == -1)
     throw std::system_error(errno, std::generic_category(), "socket creation failed");
-  bool value = true;
-  if (setsockopt(sockfd.get(), SOL_SOCKET, SO_REUSEADDR, &value, sizeof(int)) == -1)
-    throw std::system_error(errno, std::generic_category(), "socket setsockopt failed");
+  apply_options(sockfd.get(), domain, type, options);
 }
 
-Base::Base(Base&& o) : sockfd(std::move(o.sockfd)) {}
+Base::Base(void) : Base(AF_INET, SOCK_STREAM) {}
+
+Base::Base(Base&& o) : sockfd(std::move(o.sockfd)), nonblocking(o.nonblocking) {
+#ifdef SOCKET_STATS
+  counters.add(o.counters.load());
+#endif
+}
 
 Base::~Base(void) {}
 
@@ -24,30 +68,60 @@ bool Base::data_available(void) const {
   return fds.revents & POLLIN;
 }
 
+int Base::get_option(int level, int name) const {
+  int value;
+  socklen_t value_size = sizeof(int);
+  if (getsockopt(sockfd.get(), level, name, &value, &value_size) == -1)
+    throw std::system_error(errno, std::generic_category(), "socket getsockopt failed");
+  return value;
+}
+
+SocketCounters Base::get_counters(void) const noexcept {
+#ifdef SOCKET_STATS
+  return counters.load();
+#else
+  return SocketCounters();
+#endif
+}
+
+bool Base::wait(short events, int timeout_ms) const {
+  pollfd fds{sockfd.get(), events, 0};
+  int ret;
+  while ((ret = poll(&fds, 1, timeout_ms)) == -1)
+    if (errno != EINTR)
+      throw std::system_error(errno, std::generic_category(), "poll failed");
+  return ret != 0;
+}
+
 static Address get_connected_address(int sockfd) {
-  sockaddr_in addr;
-  socklen_t addr_size = sizeof(sockaddr_in);
+  sockaddr_storage addr;
+  socklen_t addr_size = sizeof(sockaddr_storage);
   if (getpeername(sockfd, (sockaddr*) &addr, &addr_size) == -1)
     throw std::system_error(errno, std::generic_category(), "getpeername failed");
-  if (addr_size > sizeof(sockaddr_in))
-    throw std::runtime_error("getpeername returned more bytes than sockaddr_in can hold");
-  std::unique_ptr<char[]> dst(std::make_unique<char[]>(sizeof(char) * INET_ADDRSTRLEN));
-  if (inet_ntop(AF_INET, &addr.sin_addr, dst.get(), INET_ADDRSTRLEN) != dst.get())
-    throw std::system_error(errno, std::generic_category(), "inet_ntop failed");
-  return Address{std::string(dst.get()), static_cast<unsigned short>(ntohs(addr.sin_port))};
+  return Address((sockaddr*) &addr, addr_size);
+}
+
+static Address get_socket_address(int sockfd) {
+  sockaddr_storage addr;
+  socklen_t addr_size = sizeof(sockaddr_storage);
+  if (getsockname(sockfd, (sockaddr*) &addr, &addr_size) == -1)
+    throw std::system_error(errno, std::generic_category(), "getsockname failed");
+  return Address((sockaddr*) &addr, addr_size);
 }
 
 Connected::Connected(const Address& listening, FileDescriptor&& sockfd) : Base(std::move(sockfd)),
     listening_address(listening), input_address(get_connected_address(this->sockfd.get())) {}
 
-Connected::Connected(const Address& listening) : listening_address(listening),
-    input_address([this] (const Address& listening) -> Address {
-      sockaddr_in addr;
-      addr.sin_family = AF_INET;
-      addr.sin_port = htons(listening.port());
-      if (!inet_aton(listening.ip().c_str(), &addr.sin_addr))
-        throw std::runtime_error("invalid address");
-      if (connect(sockfd.get(), (sockaddr*)&addr, sizeof(sockaddr_in)) == -1)
+Connected::Connected(const Address& listening, FileDescriptor&& sockfd, const Address& input,
+    bool nonblocking) : Base(std::move(sockfd), nonblocking), listening_address(listening),
+    input_address(input) {}
+
+Connected::Connected(const Address& listening, const SocketOptions& options) :
+    Base(listening.family(), get_type(options), options), listening_address(listening),
+    input_address([this, &options] (const Address& listening) -> Address {
+      if (options.fast_open && is_tcp(listening.family(), SOCK_STREAM))
+        set_option(sockfd.get(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1);
+      if (connect(sockfd.get(), listening.get_sockaddr(), listening.get_sockaddr_size()) == -1)
         throw std::system_error(errno, std::generic_category(), "socket connect failed");
       return get_connected_address(sockfd.get());
     }(listening)) {}
@@ -62,41 +136,109 @@ Connected::~Connected(void) {
 }
 
 Address Connected::get_local_address(void) {
-  sockaddr_in addr;
-  socklen_t addr_size = sizeof(sockaddr_in);
-  if (getsockname(sockfd.get(), (sockaddr*) &addr, &addr_size) == -1)
-    throw std::system_error(errno, std::generic_category(), "getsockname failed");
-  if (addr_size > sizeof(sockaddr_in))
-    throw std::runtime_error("getsockname returned more bytes than sockaddr_in can hold");
-  std::unique_ptr<char[]> dst(std::make_unique<char[]>(sizeof(char) * INET_ADDRSTRLEN));
-  if (inet_ntop(AF_INET, &addr.sin_addr, dst.get(), INET_ADDRSTRLEN) != dst.get())
-    throw std::system_error(errno, std::generic_category(), "inet_ntop failed");
-  return Address{std::string(dst.get()), static_cast<unsigned short>(ntohs(addr.sin_port))};
+  return get_socket_address(sockfd.get());
+}
+
+TcpInfo Connected::get_tcp_info(void) const {
+  tcp_info info{};
+  socklen_t info_size = sizeof(tcp_info);
+  if (getsockopt(sockfd.get(), IPPROTO_TCP, TCP_INFO, &info, &info_size) == -1)
+    throw std::system_error(errno, std::generic_category(), "socket getsockopt failed");
+  return TcpInfo{info.tcpi_state, info.tcpi_rtt, info.tcpi_rttvar, info.tcpi_snd_cwnd,
+      info.tcpi_snd_ssthresh, info.tcpi_unacked, info.tcpi_lost, info.tcpi_retransmits,
+      info.tcpi_total_retrans};
 }
 
 bool Connected::read(void* buf, size_t count, int timeout_ms) {
-  timeval timeout;
-  if (timeout_ms == -1) {
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
-  } else if (timeout_ms == 0) {
-    // special case, all zero values = block
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 1;
-  } else {
-    timeout.tv_sec = timeout_ms / 1000;
-    timeout.tv_usec = (timeout_ms % 1000) * 1000;
-  }
-  setsockopt(sockfd.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeval));
-  size_t received = 0;
-  do {
-    int ret = ::read(sockfd.get(), &((char*) buf)[received], count - received);
-    if (ret == 0 || ret == -1) {
-      if (errno == EAGAIN) return false; // timed out
+  return receive(buf, count, timeout_ms, nullptr);
+}
+
+bool Connected::read_fds(void* buf, size_t count, std::vector<FileDescriptor>& fds,
+    int timeout_ms) {
+  return receive(buf, count, timeout_ms, &fds);
+}
+
+size_t Connected::try_read(void* buf, size_t count) {
+  SOCKET_STATS_RECORD(stats, counters, STATS_READ);
+  ssize_t ret;
+  while ((ret = ::recv(sockfd.get(), buf, count, MSG_DONTWAIT)) == -1) {
+    if (errno == EAGAIN) {
+      stats.would_block();
+      return 0;
+    }
+    if (errno != EINTR)
       throw std::system_error(errno, std::generic_category(), "socket read failed");
+  }
+  if (ret == 0 && count > 0)
+    throw std::system_error(ECONNRESET, std::generic_category(), "socket closed by peer");
+  stats.read(ret);
+  return ret;
+}
+
+// Takes the descriptors out of the control messages of a recvmsg.
+static void collect_fds(msghdr& msg, std::vector<FileDescriptor>& fds) {
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+    size_t n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (size_t i = 0; i < n_fds; i++) {
+      int fd;
+      std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+      fds.emplace_back(fd);
     }
+  }
+}
+
+bool Connected::receive(void* buf, size_t count, int timeout_ms,
+    std::vector<FileDescriptor>* fds) {
+  // Reads without a timeout block in the kernel. Reads with a timeout never block in recv, they
+  // wait for readiness against a deadline covering the whole call, so no socket option is set.
+  int flags = timeout_ms == -1 ? 0 : MSG_DONTWAIT;
+  std::chrono::steady_clock::time_point deadline;
+  if (timeout_ms > 0)
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  SOCKET_STATS_RECORD(stats, counters, STATS_READ);
+  size_t received = 0;
+  while (received < count) {
+    ssize_t ret;
+    if (fds) {
+      // Room for the most descriptors the kernel passes in one message, SCM_MAX_FD.
+      alignas(cmsghdr) char control[CMSG_SPACE(253 * sizeof(int))];
+      iovec iov{&((char*) buf)[received], count - received};
+      msghdr msg{};
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      ret = ::recvmsg(sockfd.get(), &msg, flags | MSG_CMSG_CLOEXEC);
+      if (ret > 0)
+        collect_fds(msg, *fds);
+      if (ret > 0 && msg.msg_flags & MSG_CTRUNC) // the kernel closed the descriptors left out
+        throw std::runtime_error("socket read dropped descriptors that did not fit");
+    } else {
+      ret = ::recv(sockfd.get(), &((char*) buf)[received], count - received, flags);
+    }
+    if (ret == 0)
+      throw std::system_error(ECONNRESET, std::generic_category(), "socket closed by peer");
+    if (ret == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN)
+        throw std::system_error(errno, std::generic_category(), "socket read failed");
+      stats.would_block();
+      int remaining_ms = timeout_ms;
+      if (timeout_ms > 0)
+        remaining_ms = std::max<long>(0, std::chrono::ceil<std::chrono::milliseconds>(
+              deadline - std::chrono::steady_clock::now()).count());
+      if (!wait(POLLIN, remaining_ms)) {
+        stats.timeout();
+        return false;
+      }
+      continue;
+    }
+    stats.read(ret);
     received += ret;
-  } while(received < count);
+  }
   return true;
 }
 
@@ -108,53 +250,334 @@ Address Connected::get_input_address(void) const noexcept {
   return input_address;
 }
 
-Bidirectional::Bidirectional(const Address& listening) : Connected(listening),
+Bidirectional::Bidirectional(const Address& listening, const SocketOptions& options) :
+    Connected(listening, options),
     output_address(Connected::get_local_address()) {}
 
 Bidirectional::Bidirectional(Listening& listener) : Connected(listener.get_address(),
     [&listener] (void) -> FileDescriptor {
-      sockaddr_in addr;
-      socklen_t addr_size = sizeof(sockaddr_in);
+      sockaddr_storage addr;
+      socklen_t addr_size = sizeof(sockaddr_storage);
       FileDescriptor fd([&listener, &addr, &addr_size] (void) -> int {
             int sockfd;
-            if ((sockfd = ::accept(listener.sockfd.get(), (sockaddr*) &addr, &addr_size)) == -1)
-              throw std::system_error(errno, std::generic_category(), "socket accept failed");
+            while ((sockfd = ::accept(listener.sockfd.get(), (sockaddr*) &addr, &addr_size))
+                == -1) {
+              if (errno != EAGAIN)
+                throw std::system_error(errno, std::generic_category(), "socket accept failed");
+              listener.wait(POLLIN, -1); // the listening socket is non-blocking
+            }
             return sockfd;
           }());
-      if (addr_size != sizeof(sockaddr_in))
-        throw std::runtime_error("accept returned incorrect number of bytes");
+      if (listener.quick_ack)
+        set_option(fd.get(), IPPROTO_TCP, TCP_QUICKACK, 1);
       return fd;
     }()), output_address(Connected::get_local_address()) {}
 
+Bidirectional::Bidirectional(const Address& listening, FileDescriptor&& sockfd,
+    const Address& input, const Address& output, bool nonblocking) :
+    Connected(listening, std::move(sockfd), input, nonblocking), output_address(output) {}
+
 Bidirectional::Bidirectional(Bidirectional&& o) : Connected(std::move(o)),
-    output_address(o.output_address) {}
+    output_address(o.output_address), zerocopy(o.zerocopy),
+    zerocopy_sends(std::move(o.zerocopy_sends)) {}
 
 void Bidirectional::write(const void* buf, size_t count) {
+  SOCKET_STATS_RECORD(stats, counters, STATS_WRITE);
   size_t sent = 0;
   do {
     int ret = ::send(sockfd.get(), &((char*) buf)[sent], count - sent, MSG_NOSIGNAL);
+    if (ret == -1 && errno == EAGAIN && nonblocking) {
+      stats.would_block();
+      wait(POLLOUT, -1);
+      continue;
+    }
+    if (ret == -1 && errno == EINTR)
+      continue;
     if (ret == -1)
       throw std::system_error(errno, std::generic_category(), "socket write failed");
+    stats.write(ret, size_t(ret) < count - sent);
     sent += ret;
   } while (sent < count);
 }
 
+void Bidirectional::write_fds(const void* buf, size_t count, const int* fds, size_t n_fds) {
+  if (count == 0)
+    throw std::invalid_argument("descriptors must be sent with at least one byte");
+  std::vector<char> control(CMSG_SPACE(n_fds * sizeof(int)));
+  iovec iov{const_cast<void*>(buf), count};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(n_fds * sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), fds, n_fds * sizeof(int));
+  ssize_t ret;
+  {
+    SOCKET_STATS_RECORD(stats, counters, STATS_WRITE);
+    while ((ret = ::sendmsg(sockfd.get(), &msg, MSG_NOSIGNAL)) == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN || !nonblocking)
+        throw std::system_error(errno, std::generic_category(), "socket write failed");
+      stats.would_block();
+      wait(POLLOUT, -1);
+    }
+    stats.write(ret, size_t(ret) < count);
+  }
+  // The descriptors went with the first byte, the rest is plain data.
+  if (size_t(ret) < count)
+    write(&((const char*) buf)[ret], count - ret);
+}
+
+void Bidirectional::writev(const iovec* iov, size_t iovcnt, size_t* written) {
+  msghdr msg{};
+  msg.msg_iov = const_cast<iovec*>(iov);
+  size_t left = iovcnt;
+  std::vector<iovec> partial; // mutable copy, only needed once a buffer is partially sent
+  while (left > 0 && msg.msg_iov[0].iov_len == 0) {
+    msg.msg_iov++;
+    left--;
+  }
+  if (written)
+    *written = 0;
+  SOCKET_STATS_RECORD(stats, counters, STATS_WRITE);
+  while (left > 0) {
+    msg.msg_iovlen = std::min<size_t>(left, IOV_MAX);
+    ssize_t ret = ::sendmsg(sockfd.get(), &msg, MSG_NOSIGNAL);
+    if (ret == -1 && errno == EAGAIN && nonblocking) {
+      stats.would_block();
+      wait(POLLOUT, -1);
+      continue;
+    }
+    if (ret == -1 && errno == EINTR)
+      continue;
+    if (ret == -1)
+      throw std::system_error(errno, std::generic_category(), "socket write failed");
+    if (written)
+      *written += ret;
+    size_t sent = ret;
+    size_t offered = msg.msg_iovlen;
+    while (left > 0 && sent >= msg.msg_iov[0].iov_len) {
+      sent -= msg.msg_iov[0].iov_len;
+      msg.msg_iov++;
+      left--;
+      offered--;
+    }
+    stats.write(ret, offered > 0);
+    if (sent > 0) {
+      if (partial.empty()) {
+        partial.assign(msg.msg_iov, msg.msg_iov + left);
+        msg.msg_iov = partial.data();
+      }
+      msg.msg_iov[0].iov_base = &((char*) msg.msg_iov[0].iov_base)[sent];
+      msg.msg_iov[0].iov_len -= sent;
+    }
+  }
+}
+
+size_t Bidirectional::try_writev(const iovec* iov, size_t iovcnt) {
+  msghdr msg{};
+  msg.msg_iov = const_cast<iovec*>(iov);
+  msg.msg_iovlen = std::min<size_t>(iovcnt, IOV_MAX);
+  SOCKET_STATS_RECORD(stats, counters, STATS_WRITE);
+  ssize_t ret;
+  while ((ret = ::sendmsg(sockfd.get(), &msg, MSG_DONTWAIT | MSG_NOSIGNAL)) == -1) {
+    if (errno == EAGAIN) {
+      stats.would_block();
+      return 0;
+    }
+    if (errno != EINTR)
+      throw std::system_error(errno, std::generic_category(), "socket write failed");
+  }
+  size_t offered = 0;
+  for (size_t i = 0; i < msg.msg_iovlen; i++)
+    offered += iov[i].iov_len;
+  stats.write(ret, size_t(ret) < offered);
+  return ret;
+}
+
+void Bidirectional::send_file(int fd, off_t offset, size_t count) {
+  size_t sent = 0;
+  bool use_sendfile = true;
+  bool use_splice = true;
+  SOCKET_STATS_RECORD(stats, counters, STATS_WRITE); // the copy falls back on write, counted there
+  while (sent < count) {
+    ssize_t ret;
+    if (use_sendfile)
+      ret = ::sendfile(sockfd.get(), fd, &offset, count - sent);
+    else if (use_splice)
+      ret = ::splice(fd, nullptr, sockfd.get(), nullptr, count - sent,
+          SPLICE_F_MOVE | SPLICE_F_MORE);
+    else { // neither applies to this kind of fd, copy through user space
+      char buf[65536];
+      ret = ::pread(fd, buf, std::min(sizeof(buf), count - sent), offset);
+      if (ret == -1 && errno == ESPIPE)
+        ret = ::read(fd, buf, std::min(sizeof(buf), count - sent));
+      if (ret > 0) {
+        write(buf, ret);
+        offset += ret;
+      }
+    }
+    if (ret == -1 && (errno == EINVAL || errno == ESPIPE) && sent == 0 && use_splice) {
+      // sendfile needs a seekable fd and splice needs a pipe, fall back one step at a time
+      if (use_sendfile)
+        use_sendfile = false;
+      else
+        use_splice = false;
+      continue;
+    }
+    if (ret == -1 && errno == EAGAIN && nonblocking) {
+      if (use_splice)
+        stats.would_block();
+      wait(POLLOUT, -1);
+      continue;
+    }
+    if (ret == -1 && errno == EINTR)
+      continue;
+    if (ret == -1)
+      throw std::system_error(errno, std::generic_category(), "socket send file failed");
+    if (ret == 0)
+      throw std::runtime_error("file ended before count bytes were sent");
+    if (use_splice)
+      stats.write(ret, size_t(ret) < count - sent);
+    sent += ret;
+  }
+}
+
+bool Bidirectional::enable_zerocopy(void) {
+  int value = 1;
+  if (setsockopt(sockfd.get(), SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(int)) == -1) {
+    if (errno == ENOPROTOOPT || errno == EINVAL || errno == EOPNOTSUPP)
+      return false;
+    throw std::system_error(errno, std::generic_category(), "socket setsockopt failed");
+  }
+  zerocopy = true;
+  return true;
+}
+
+uint64_t Bidirectional::send_zerocopy(const void* buf, size_t count) {
+  if (!zerocopy) {
+    write(buf, count);
+    return zerocopy_sends.get_sent(); // nothing new to wait for
+  }
+  SOCKET_STATS_RECORD(stats, counters, STATS_WRITE);
+  size_t sent = 0;
+  while (sent < count) {
+    ssize_t ret = ::send(sockfd.get(), &((char*) buf)[sent], count - sent,
+        MSG_NOSIGNAL | MSG_ZEROCOPY);
+    if (ret == -1 && errno == ENOBUFS) { // pinned page limit reached, copy the rest
+      write(&((char*) buf)[sent], count - sent);
+      break;
+    }
+    if (ret == -1 && errno == EAGAIN && nonblocking) {
+      stats.would_block();
+      wait(POLLOUT, -1);
+      continue;
+    }
+    if (ret == -1 && errno == EINTR)
+      continue;
+    if (ret == -1)
+      throw std::system_error(errno, std::generic_category(), "socket write failed");
+    stats.write(ret, size_t(ret) < count - sent);
+    zerocopy_sends.send();
+    sent += ret;
+  }
+  return zerocopy_sends.get_sent();
+}
+
+uint64_t Bidirectional::zerocopy_completed(int timeout_ms) {
+  if (zerocopy_sends.get_completed() == zerocopy_sends.get_sent())
+    return zerocopy_sends.get_completed();
+  bool waited = false;
+  while (true) {
+    char control[CMSG_SPACE(sizeof(sock_extended_err))];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(sockfd.get(), &msg, MSG_ERRQUEUE) == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN)
+        throw std::system_error(errno, std::generic_category(), "socket error queue read failed");
+      if (waited || zerocopy_sends.get_completed() == zerocopy_sends.get_sent() ||
+          !wait(POLLERR, timeout_ms))
+        return zerocopy_sends.get_completed();
+      waited = true; // errors are always polled for
+      continue;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+        continue;
+      sock_extended_err err;
+      std::memcpy(&err, CMSG_DATA(cmsg), sizeof(sock_extended_err));
+      if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+      zerocopy_sends.complete(err.ee_info, err.ee_data);
+    }
+  }
+}
+
+void ZerocopyCompletions::complete(uint32_t first, uint32_t last) {
+  // Ranges are placed by their distance from done, so the kernel's numbers may wrap. A range
+  // that does not fall within the sends in flight was already counted and is dropped.
+  uint64_t begin = done + uint32_t(first - uint32_t(done));
+  uint64_t end = begin + uint32_t(last - first) + 1;
+  if (begin >= sent || end > sent)
+    return;
+  if (begin != done) { // an earlier send is still pinned
+    ahead.emplace_back(begin, end);
+    return;
+  }
+  done = end;
+  for (bool merged = true; merged;) {
+    merged = false;
+    for (auto it = ahead.begin(); it != ahead.end(); it++) {
+      if (it->first > done)
+        continue;
+      done = std::max(done, it->second);
+      ahead.erase(it);
+      merged = true;
+      break;
+    }
+  }
+}
+
 Address Bidirectional::get_address(void) const noexcept {
   return output_address;
 }
 
-Listening::Listening(unsigned short port) : address{get_my_ip(), port},
+Listening::Listening(unsigned short port, const SocketOptions& options) :
+    Listening(Address("0.0.0.0", port), options) {}
+
+Listening::Listening(const Address& bind_address, const SocketOptions& options) :
+    Base(bind_address.family(), get_type(options), options), address(bind_address),
+    local_address(bind_address), bound_to_any(bind_address.is_any()),
+    quick_ack(options.quick_ack && is_tcp(bind_address.family(), get_type(options))),
     listen_epfd(epoll_create(1)) {
   if (listen_epfd == -1)
     throw std::system_error(errno, std::generic_category(), "epoll create failed");
-  sockaddr_in addr;
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(port);
-  addr.sin_addr.s_addr = INADDR_ANY; // Automatically select an IP address
-  if (bind(sockfd.get(), (sockaddr*)&addr, sizeof(sockaddr_in)) == -1)
+  if (is_tcp(bind_address.family(), get_type(options)) && options.defer_accept_s)
+    set_option(sockfd.get(), IPPROTO_TCP, TCP_DEFER_ACCEPT, options.defer_accept_s);
+  if (is_tcp(bind_address.family(), get_type(options)) && options.fast_open)
+    set_option(sockfd.get(), IPPROTO_TCP, TCP_FASTOPEN, options.fast_open);
+  if (bind(sockfd.get(), bind_address.get_sockaddr(), bind_address.get_sockaddr_size()) == -1)
     throw std::system_error(errno, std::generic_category(), "socket bind failed");
-  if (listen(sockfd.get(), BACKLOG) == -1)
+  if (listen(sockfd.get(), options.backlog) == -1)
     throw std::system_error(errno, std::generic_category(), "socket listen failed");
+  if (bind_address.port() == 0) // an ephemeral port was picked
+    local_address = address = get_socket_address(sockfd.get());
+  if (bound_to_any) // peers connect through an interface address
+    address = Address(get_my_ip(), local_address.port());
+  // Non-blocking so that a batch accept stops once the backlog is drained.
+  int flags = fcntl(sockfd.get(), F_GETFL);
+  if (flags == -1 || fcntl(sockfd.get(), F_SETFL, flags | O_NONBLOCK) == -1)
+    throw std::system_error(errno, std::generic_category(), "fcntl failed");
+  nonblocking = true;
   epoll_event ev;
   ev.events = EPOLLIN;
   ev.data.fd = sockfd.get();
@@ -163,12 +586,17 @@ Listening::Listening(unsigned short port) : address{get_my_ip(), port},
 }
 
 Listening::Listening(Listening&& o) : Base(std::move(o)), address(o.address),
+    local_address(o.local_address), bound_to_any(o.bound_to_any), quick_ack(o.quick_ack),
     listen_epfd(std::move(o.listen_epfd)), mutex(std::move(o.mutex)) {}
 
 Listening::~Listening(void) {
-  if (sockfd.get() != -1)
-    if (shutdown(sockfd.get(), SHUT_RDWR) == -1)
-      std::cerr << "WARNING: socket shutdown failed: " << std::strerror(errno) << std::endl;
+  if (sockfd.get() == -1)
+    return;
+  if (shutdown(sockfd.get(), SHUT_RDWR) == -1)
+    std::cerr << "WARNING: socket shutdown failed: " << std::strerror(errno) << std::endl;
+  std::string path(local_address.path());
+  if (!path.empty() && path[0] != '@' && unlink(path.c_str()) == -1)
+    std::cerr << "WARNING: socket unlink failed: " << std::strerror(errno) << std::endl;
 }
 
 std::unique_ptr<Bidirectional> Listening::accept(int timeout_ms) {
@@ -180,17 +608,194 @@ std::unique_ptr<Bidirectional> Listening::accept(int timeout_ms) {
     throw std::system_error(errno, std::generic_category(), "epoll wait failed");
   assert(ret == 1);
   assert(ev.events & EPOLLIN);
-  return std::make_unique<Bidirectional>(*this);
+  return accept_one(0);
+}
+
+std::vector<std::unique_ptr<Bidirectional>> Listening::accept_batch(size_t max, int timeout_ms) {
+  std::vector<std::unique_ptr<Bidirectional>> accepted;
+  epoll_event ev;
+  int ret = epoll_wait(listen_epfd.get(), &ev, 1, timeout_ms);
+  if ((ret == -1 && errno == EINTR) || ret == 0) // interrupted or timeout
+    return accepted;
+  if (ret == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll wait failed");
+  assert(ret == 1);
+  assert(ev.events & EPOLLIN);
+  while (accepted.size() < max) {
+    std::unique_ptr<Bidirectional> b;
+    try {
+      b = accept_one(SOCK_NONBLOCK | SOCK_CLOEXEC);
+    } catch (...) {
+      if (accepted.empty())
+        throw;
+      break; // the next call reports the error if it persists
+    }
+    if (!b) // backlog drained
+      break;
+    accepted.push_back(std::move(b));
+  }
+  return accepted;
+}
+
+std::unique_ptr<Bidirectional> Listening::accept_one(int flags) {
+  Address peer;
+  int fd = accept_fd(flags, peer);
+  if (fd == -1)
+    return nullptr;
+  return adopt(FileDescriptor(fd), peer, flags & SOCK_NONBLOCK);
+}
+
+int Listening::accept_fd(int flags, Address& peer) {
+  SOCKET_STATS_RECORD(stats, counters, STATS_ACCEPT);
+  sockaddr_storage addr;
+  socklen_t addr_size;
+  int fd;
+  do {
+    addr_size = sizeof(sockaddr_storage);
+    fd = accept4(sockfd.get(), (sockaddr*) &addr, &addr_size, flags);
+  } while (fd == -1 && (errno == EINTR || errno == ECONNABORTED));
+  if (fd == -1 && errno == EAGAIN) { // backlog drained or another thread took the connection
+    stats.would_block();
+    return -1;
+  }
+  if (fd == -1)
+    throw std::system_error(errno, std::generic_category(), "socket accept failed");
+  stats.accept();
+  try {
+    peer = Address((sockaddr*) &addr, addr_size); // the peer address comes from accept itself
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  return fd;
+}
+
+Address Listening::prepare_accepted(int fd) {
+  if (quick_ack)
+    set_option(fd, IPPROTO_TCP, TCP_QUICKACK, 1);
+  // The local address is resolved here, while only this thread holds the socket. It is only
+  // looked up when the listener is bound to INADDR_ANY, otherwise every accepted socket shares
+  // the bound address.
+  return bound_to_any ? get_socket_address(fd) : local_address;
+}
+
+std::unique_ptr<Bidirectional> Listening::adopt(FileDescriptor&& fd, const Address& peer,
+    bool nonblocking) {
+  Address output(prepare_accepted(fd.get()));
+  return std::unique_ptr<Bidirectional>(new Bidirectional(address, std::move(fd), peer, output,
+        nonblocking));
+}
+
+std::unique_ptr<Bidirectional> Listening::adopt(FileDescriptor&& fd, bool nonblocking) {
+  Address peer(get_connected_address(fd.get()));
+  return adopt(std::move(fd), peer, nonblocking);
 }
 
 Address Listening::get_address(void) const noexcept {
   return address;
 }
 
-#define DEFAULT_CONNECT_IP "8.8.8.8"
-#define DEFAULT_CONNECT_PORT 53
+std::vector<ConnectResult> connect_many(const std::vector<Address>& addresses,
+    int timeout_ms, const SocketOptions& options) {
+  std::vector<ConnectResult> results(addresses.size());
+  std::vector<FileDescriptor> fds;
+  fds.reserve(addresses.size());
+  FileDescriptor epfd(epoll_create1(EPOLL_CLOEXEC));
+  if (epfd == -1)
+    throw std::system_error(errno, std::generic_category(), "epoll create failed");
+  size_t pending = 0;
+  for (size_t i = 0; i < addresses.size(); i++) {
+    fds.emplace_back(::socket(addresses[i].family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+          0));
+    if (fds[i] == -1) {
+      results[i].error = errno;
+      continue;
+    }
+    apply_options(fds[i].get(), addresses[i].family(), SOCK_STREAM, options);
+    if (options.fast_open && is_tcp(addresses[i].family(), SOCK_STREAM))
+      set_option(fds[i].get(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1);
+    if (connect(fds[i].get(), addresses[i].get_sockaddr(), addresses[i].get_sockaddr_size()) == -1
+        && errno != EINPROGRESS) {
+      results[i].error = errno;
+      continue;
+    }
+    results[i].error = EINPROGRESS; // until epoll reports the outcome, even if already connected
+    epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.u64 = i;
+    if (epoll_ctl(epfd.get(), EPOLL_CTL_ADD, fds[i].get(), &ev) == -1)
+      throw std::system_error(errno, std::generic_category(), "epoll_ctl failed");
+    pending++;
+  }
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+  std::vector<epoll_event> events(std::min<size_t>(std::max<size_t>(pending, 1), 1024));
+  while (pending > 0) {
+    int remaining_ms = timeout_ms;
+    if (timeout_ms > 0)
+      remaining_ms = std::max<long>(0, std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+    int ret = epoll_wait(epfd.get(), events.data(), events.size(), remaining_ms);
+    if (ret == -1 && errno == EINTR)
+      continue;
+    if (ret == -1)
+      throw std::system_error(errno, std::generic_category(), "epoll wait failed");
+    if (ret == 0)
+      break; // timed out
+    for (int e = 0; e < ret; e++) {
+      size_t i = events[e].data.u64;
+      int error;
+      socklen_t error_size = sizeof(int);
+      if (getsockopt(fds[i].get(), SOL_SOCKET, SO_ERROR, &error, &error_size) == -1)
+        error = errno;
+      if (epoll_ctl(epfd.get(), EPOLL_CTL_DEL, fds[i].get(), nullptr) == -1)
+        throw std::system_error(errno, std::generic_category(), "epoll_ctl failed");
+      results[i].error = error;
+      pending--;
+    }
+  }
+  for (size_t i = 0; i < addresses.size(); i++) {
+    if (results[i].error == EINPROGRESS)
+      results[i].error = ETIMEDOUT;
+    if (results[i].error != 0)
+      continue;
+    Address output(get_socket_address(fds[i].get()));
+    results[i].connection = std::unique_ptr<Bidirectional>(new Bidirectional(addresses[i],
+          std::move(fds[i]), addresses[i], output, true));
+  }
+  return results;
+}
+
+std::pair<std::unique_ptr<Bidirectional>, std::unique_ptr<Bidirectional>> socket_pair(
+    const SocketOptions& options) {
+  int fds[2];
+  if (socketpair(AF_UNIX, get_type(options) | SOCK_CLOEXEC, 0, fds) == -1)
+    throw std::system_error(errno, std::generic_category(), "socketpair failed");
+  FileDescriptor a(fds[0]), b(fds[1]);
+  apply_options(a.get(), AF_UNIX, get_type(options), options);
+  apply_options(b.get(), AF_UNIX, get_type(options), options);
+  Address unnamed(Address::local_abstract(""));
+  return {std::unique_ptr<Bidirectional>(new Bidirectional(unnamed, std::move(a), unnamed,
+        unnamed, false)), std::unique_ptr<Bidirectional>(new Bidirectional(unnamed, std::move(b),
+        unnamed, unnamed, false))};
+}
+
+static std::string find_my_ip(void) {
+  ifaddrs* interfaces;
+  if (getifaddrs(&interfaces) == -1)
+    throw std::system_error(errno, std::generic_category(), "getifaddrs failed");
+  std::unique_ptr<ifaddrs, decltype(&freeifaddrs)> guard(interfaces, &freeifaddrs);
+  for (ifaddrs* i = interfaces; i; i = i->ifa_next)
+    if (i->ifa_addr && i->ifa_addr->sa_family == AF_INET && i->ifa_flags & IFF_UP &&
+        i->ifa_flags & IFF_RUNNING && !(i->ifa_flags & IFF_LOOPBACK))
+      return Address(*(sockaddr_in*) i->ifa_addr).ip();
+  return "127.0.0.1"; // offline, only this host can connect
+}
+
 std::string get_my_ip(void) {
-  return Connected(Address(DEFAULT_CONNECT_IP, DEFAULT_CONNECT_PORT)).get_local_address().ip();
+  // Interfaces are looked up once per process.
+  static const std::string ip = find_my_ip();
+  return ip;
 }
 } // namespace socket
 } // namespace wrapper
@@ -0,0 +1,138 @@
+#include "socket/stats.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace wrapper {
+namespace socket {
+
+static const size_t N_COUNTERS = sizeof(SocketCounters) / sizeof(uint64_t);
+
+SocketCounters& SocketCounters::operator+=(const SocketCounters& o) {
+  uint64_t* dst = reinterpret_cast<uint64_t*>(this);
+  const uint64_t* src = reinterpret_cast<const uint64_t*>(&o);
+  for (size_t i = 0; i < N_COUNTERS; i++)
+    dst[i] += src[i];
+  return *this;
+}
+
+uint64_t LatencyHistogram::count(void) const noexcept {
+  uint64_t n = 0;
+  for (size_t i = 0; i < BUCKETS; i++)
+    n += buckets[i];
+  return n;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const noexcept {
+  uint64_t n = count();
+  if (n == 0)
+    return 0;
+  uint64_t rank = std::max<uint64_t>(1, fraction * n + 0.5);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS - 1; i++) {
+    seen += buckets[i];
+    if (seen >= rank)
+      return uint64_t(1) << (i + 1);
+  }
+  return UINT64_MAX;
+}
+
+#ifdef SOCKET_STATS
+struct Registry {
+  std::mutex mutex;
+  std::vector<ThreadStats*> threads;
+  StatsSnapshot exited;
+};
+
+static Registry& get_registry(void) {
+  static Registry* registry = new Registry(); // never destroyed, threads may outlive statics
+  return *registry;
+}
+
+static void add_to(StatsSnapshot& snapshot, const ThreadStats& stats) {
+  uint64_t* counters = reinterpret_cast<uint64_t*>(&snapshot.counters);
+  for (size_t i = 0; i < N_COUNTERS; i++)
+    counters[i] += stats.counters[i].load(std::memory_order_relaxed);
+  for (size_t op = 0; op < STATS_OPERATIONS; op++)
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++)
+      snapshot.latency[op].buckets[i] += stats.latency[op][i].load(std::memory_order_relaxed);
+}
+
+ThreadStats::ThreadStats(void) {
+  for (auto& c : counters)
+    c.store(0, std::memory_order_relaxed);
+  for (auto& op : latency)
+    for (auto& b : op)
+      b.store(0, std::memory_order_relaxed);
+  Registry& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.threads.push_back(this);
+}
+
+ThreadStats::~ThreadStats(void) {
+  Registry& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  add_to(registry.exited, *this);
+  registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+}
+
+ThreadStats& get_thread_stats(void) {
+  static thread_local ThreadStats stats;
+  return stats;
+}
+
+SharedCounters::SharedCounters(void) {
+  for (auto& c : counters)
+    c.store(0, std::memory_order_relaxed);
+}
+
+void SharedCounters::add(const SocketCounters& delta) noexcept {
+  const uint64_t* src = reinterpret_cast<const uint64_t*>(&delta);
+  for (size_t i = 0; i < N_COUNTERS; i++)
+    if (src[i])
+      counters[i].fetch_add(src[i], std::memory_order_relaxed);
+}
+
+SocketCounters SharedCounters::load(void) const noexcept {
+  SocketCounters snapshot;
+  uint64_t* dst = reinterpret_cast<uint64_t*>(&snapshot);
+  for (size_t i = 0; i < N_COUNTERS; i++)
+    dst[i] = counters[i].load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+  // Only this thread writes the counter, no read-modify-write instruction is needed.
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+StatsRecorder::~StatsRecorder(void) {
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  socket.add(delta);
+  ThreadStats& stats = get_thread_stats();
+  const uint64_t* counters = reinterpret_cast<const uint64_t*>(&delta);
+  for (size_t i = 0; i < N_COUNTERS; i++)
+    if (counters[i])
+      add(stats.counters[i], counters[i]);
+  add(stats.latency[operation][63 - __builtin_clzll(ns | 1)], 1);
+}
+
+StatsSnapshot get_stats(void) {
+  StatsSnapshot snapshot;
+  Registry& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  snapshot = registry.exited;
+  for (ThreadStats* stats : registry.threads)
+    add_to(snapshot, *stats);
+  return snapshot;
+}
+#else
+StatsSnapshot get_stats(void) {
+  return StatsSnapshot();
+}
+#endif
+
+} // namespace socket
+} // namespace wrapper
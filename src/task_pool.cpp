@@ -0,0 +1,102 @@
+#include "socket/task_pool.hpp"
+
+namespace wrapper {
+namespace socket {
+
+static thread_local TaskPool* current_pool = nullptr;
+static thread_local size_t current_queue;
+
+static size_t get_n_threads(size_t n_threads) {
+  if (n_threads == 0)
+    n_threads = std::thread::hardware_concurrency();
+  return n_threads ? n_threads : 1;
+}
+
+TaskPool::TaskPool(size_t n_threads) : n_threads(get_n_threads(n_threads)),
+    queues(std::make_unique<Queue[]>(this->n_threads)), pending(0), stopping(false) {
+  threads.reserve(this->n_threads);
+  for (size_t i = 0; i < this->n_threads; i++)
+    threads.emplace_back(&TaskPool::run, this, i);
+}
+
+TaskPool::~TaskPool(void) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
+void TaskPool::submit(std::function<void(void)> task) {
+  Queue& queue = current_pool == this ? queues[current_queue] : injected;
+  {
+    // Counted under the queue lock, so a thief cannot take the task and decrement first.
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    pending++;
+  }
+  {
+    // A thread between checking pending and waiting holds the mutex, so it cannot miss this.
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+  wake.notify_one();
+}
+
+size_t TaskPool::size(void) const noexcept {
+  return n_threads;
+}
+
+bool TaskPool::take(size_t i, std::function<void(void)>& task) {
+  {
+    Queue& own = queues[i];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      pending--;
+      return true;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(injected.mutex);
+    if (!injected.tasks.empty()) {
+      task = std::move(injected.tasks.front());
+      injected.tasks.pop_front();
+      pending--;
+      return true;
+    }
+  }
+  for (size_t k = 1; k < n_threads; k++) {
+    Queue& victim = queues[(i + k) % n_threads];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskPool::run(size_t i) {
+  current_pool = this;
+  current_queue = i;
+  std::function<void(void)> task;
+  while (true) {
+    if (take(i, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.wait(lock, [this] (void) { return stopping || pending > 0; });
+    if (stopping && pending == 0)
+      return;
+  }
+}
+
+} // namespace socket
+} // namespace wrapper
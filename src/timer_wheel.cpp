@@ -0,0 +1,149 @@
+#include "socket/timer_wheel.hpp"
+
+#include <sys/timerfd.h>
+
+namespace wrapper {
+namespace socket {
+
+TimerWheel::Timer::Timer(std::function<void(void)> callback) : Link{this, this},
+    callback(std::move(callback)) {}
+
+TimerWheel::Timer::~Timer(void) {
+  if (wheel)
+    wheel->cancel(*this);
+}
+
+bool TimerWheel::Timer::armed(void) const noexcept {
+  return wheel != nullptr;
+}
+
+TimerWheel::TimerWheel(Reactor& reactor, std::chrono::milliseconds tick, size_t slots) :
+    reactor(reactor), timerfd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+    tick(tick), slots(slots), current(0), n_armed(0) {
+  if (timerfd == -1)
+    throw std::system_error(errno, std::generic_category(), "timerfd create failed");
+  if (tick.count() <= 0 || slots == 0)
+    throw std::invalid_argument("timer wheel needs a positive tick and at least one slot");
+  for (Link& head : this->slots)
+    head.prev = head.next = &head;
+  expired.prev = expired.next = &expired;
+  // The timerfd only ticks while timers are armed, so an idle wheel never wakes the reactor.
+  reactor.add(timerfd.get(), Reactor::Handlers{[this] (void) { advance(); }, nullptr, nullptr});
+}
+
+TimerWheel::~TimerWheel(void) {
+  reactor.remove(timerfd.get());
+  while (expired.next != &expired)
+    cancel(*static_cast<Timer*>(expired.next));
+  for (Link& head : slots)
+    while (head.next != &head)
+      cancel(*static_cast<Timer*>(head.next));
+}
+
+void TimerWheel::start(void) {
+  itimerspec spec;
+  spec.it_interval.tv_sec = tick.count() / 1000;
+  spec.it_interval.tv_nsec = tick.count() % 1000 * 1000000;
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(timerfd.get(), 0, &spec, nullptr) == -1)
+    throw std::system_error(errno, std::generic_category(), "timerfd settime failed");
+}
+
+void TimerWheel::stop(void) noexcept {
+  // Disarming also clears expirations not read yet. It cannot fail on a valid timerfd.
+  itimerspec spec{};
+  timerfd_settime(timerfd.get(), 0, &spec, nullptr);
+}
+
+void TimerWheel::link(Link& head, Link& node) noexcept {
+  node.prev = head.prev;
+  node.next = &head;
+  head.prev->next = &node;
+  head.prev = &node;
+}
+
+void TimerWheel::unlink(Link& node) noexcept {
+  node.prev->next = node.next;
+  node.next->prev = node.prev;
+  node.prev = node.next = &node;
+}
+
+void TimerWheel::arm(Timer& timer, std::chrono::milliseconds delay) {
+  if (timer.wheel && timer.wheel != this)
+    throw std::invalid_argument("timer is armed on another wheel");
+  // Rounded up, and at least one tick so that a timer never fires in the tick arming it.
+  size_t ticks = std::max<long>(1, (delay.count() + tick.count() - 1) / tick.count());
+  if (n_armed == 0) {
+    start();
+  } else {
+    // The next tick may be due any moment and expirations not read yet leave current behind, so
+    // catch up and wait one tick more than the delay needs.
+    turn(elapsed());
+    ticks++;
+  }
+  if (timer.wheel)
+    unlink(timer);
+  else
+    n_armed++;
+  timer.wheel = this;
+  timer.rounds = (ticks - 1) / slots.size();
+  link(slots[(current + ticks) % slots.size()], timer);
+}
+
+void TimerWheel::cancel(Timer& timer) noexcept {
+  if (timer.wheel != this)
+    return;
+  unlink(timer);
+  timer.wheel = nullptr;
+  if (--n_armed == 0)
+    stop();
+}
+
+uint64_t TimerWheel::elapsed(void) {
+  uint64_t ticks;
+  if (::read(timerfd.get(), &ticks, sizeof(uint64_t)) == -1) {
+    if (errno == EAGAIN)
+      return 0;
+    throw std::system_error(errno, std::generic_category(), "timerfd read failed");
+  }
+  return ticks;
+}
+
+void TimerWheel::turn(uint64_t ticks) noexcept {
+  for (uint64_t t = 0; t < ticks; t++) {
+    current = (current + 1) % slots.size();
+    Link& head = slots[current];
+    for (Link* node = head.next; node != &head;) {
+      Timer* timer = static_cast<Timer*>(node);
+      node = node->next;
+      if (timer->rounds > 0) {
+        timer->rounds--;
+        continue;
+      }
+      unlink(*timer);
+      link(expired, *timer);
+    }
+  }
+}
+
+size_t TimerWheel::advance(void) {
+  // Due timers move to the expired list first, so callbacks may arm or cancel any timer. Timers
+  // an arm moved there fire here too, on the tick after it.
+  turn(elapsed());
+  size_t fired = 0;
+  while (expired.next != &expired) {
+    Timer* timer = static_cast<Timer*>(expired.next);
+    cancel(*timer);
+    std::function<void(void)> callback(timer->callback); // the callback may destroy its timer
+    callback();
+    fired++;
+  }
+  return fired;
+}
+
+size_t TimerWheel::size(void) const noexcept {
+  return n_armed;
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,140 @@
+#include "socket/tls.hpp"
+
+#ifdef SOCKET_HAVE_TLS
+#include <fstream>
+#include <iterator>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+namespace wrapper {
+namespace socket {
+
+static std::runtime_error tls_error(const std::string& what) {
+  char reason[256];
+  ERR_error_string_n(ERR_get_error(), reason, sizeof(reason));
+  ERR_clear_error();
+  return std::runtime_error(what + ": " + reason);
+}
+
+// The suites the kernel can take over. TLS 1.3 suites are all AES-GCM or ChaCha20-Poly1305.
+static const char* KTLS_CIPHERS = "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+    "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"
+    "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305";
+
+static SSL_CTX* new_context(const SSL_METHOD* method) {
+  SSL_CTX* context = SSL_CTX_new(method);
+  if (!context)
+    throw tls_error("SSL_CTX_new failed");
+  SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+  SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+#if OPENSSL_VERSION_NUMBER < 0x30200000L
+  // Earlier versions only offload the sending side of TLS 1.3.
+  SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+#endif
+  if (SSL_CTX_set_cipher_list(context, KTLS_CIPHERS) != 1) {
+    SSL_CTX_free(context);
+    throw tls_error("SSL_CTX_set_cipher_list failed");
+  }
+  return context;
+}
+
+TlsContext::TlsContext(SSL_CTX* context, bool is_server) : context(context, &SSL_CTX_free),
+    is_server(is_server) {
+  // Tickets would arrive as records the kernel cannot hand to read.
+  if (is_server)
+    SSL_CTX_set_num_tickets(context, 0);
+}
+
+TlsContext::TlsContext(TlsContext&& o) : context(std::move(o.context)), is_server(o.is_server) {}
+
+TlsContext TlsContext::server(const std::string& certificate_file, const std::string& key_file) {
+  TlsContext tls(new_context(TLS_server_method()), true);
+  if (SSL_CTX_use_certificate_chain_file(tls.get(), certificate_file.c_str()) != 1)
+    throw tls_error("cannot load certificate");
+  if (SSL_CTX_use_PrivateKey_file(tls.get(), key_file.c_str(), SSL_FILETYPE_PEM) != 1)
+    throw tls_error("cannot load private key");
+  return tls;
+}
+
+TlsContext TlsContext::self_signed(const std::string& common_name) {
+  TlsContext tls(new_context(TLS_server_method()), true);
+  std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(EVP_EC_gen("P-256"), &EVP_PKEY_free);
+  std::unique_ptr<X509, decltype(&X509_free)> certificate(X509_new(), &X509_free);
+  if (!key || !certificate)
+    throw tls_error("cannot create key");
+  X509_set_version(certificate.get(), 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 365 * 24 * 3600);
+  X509_NAME* name = X509_get_subject_name(certificate.get());
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+      reinterpret_cast<const unsigned char*>(common_name.c_str()), -1, -1, 0);
+  X509_set_issuer_name(certificate.get(), name);
+  X509_set_pubkey(certificate.get(), key.get());
+  if (X509_sign(certificate.get(), key.get(), EVP_sha256()) == 0)
+    throw tls_error("cannot sign certificate");
+  if (SSL_CTX_use_certificate(tls.get(), certificate.get()) != 1 ||
+      SSL_CTX_use_PrivateKey(tls.get(), key.get()) != 1)
+    throw tls_error("cannot use certificate");
+  return tls;
+}
+
+TlsContext TlsContext::client(const std::string& ca_file, bool verify) {
+  TlsContext tls(new_context(TLS_client_method()), false);
+  // A TLS 1.3 server may send session tickets after the handshake, which the kernel would fail
+  // the first read on.
+  SSL_CTX_set_max_proto_version(tls.get(), TLS1_2_VERSION);
+  if (!verify)
+    return tls;
+  SSL_CTX_set_verify(tls.get(), SSL_VERIFY_PEER, nullptr);
+  int ret = ca_file.empty() ? SSL_CTX_set_default_verify_paths(tls.get()) :
+      SSL_CTX_load_verify_locations(tls.get(), ca_file.c_str(), nullptr);
+  if (ret != 1)
+    throw tls_error("cannot load trusted certificates");
+  return tls;
+}
+
+SSL_CTX* TlsContext::get(void) const noexcept {
+  return context.get();
+}
+
+void TlsContext::handshake(Bidirectional& connection, const std::string& server_name) const {
+  std::unique_ptr<SSL, decltype(&SSL_free)> ssl(SSL_new(context.get()), &SSL_free);
+  if (!ssl || SSL_set_fd(ssl.get(), connection.sockfd.get()) != 1)
+    throw tls_error("cannot create TLS session");
+  if (!is_server && !server_name.empty() &&
+      (SSL_set_tlsext_host_name(ssl.get(), server_name.c_str()) != 1 ||
+       SSL_set1_host(ssl.get(), server_name.c_str()) != 1))
+    throw tls_error("cannot set server name");
+  while (true) {
+    int ret = is_server ? SSL_accept(ssl.get()) : SSL_connect(ssl.get());
+    if (ret == 1)
+      break;
+    int error = SSL_get_error(ssl.get(), ret);
+    if (error == SSL_ERROR_WANT_READ)
+      connection.wait(POLLIN, -1);
+    else if (error == SSL_ERROR_WANT_WRITE)
+      connection.wait(POLLOUT, -1);
+    else if (error == SSL_ERROR_SYSCALL && errno != 0)
+      throw std::system_error(errno, std::generic_category(), "TLS handshake failed");
+    else
+      throw tls_error("TLS handshake failed");
+  }
+  if (BIO_get_ktls_send(SSL_get_wbio(ssl.get())) != 1 ||
+      BIO_get_ktls_recv(SSL_get_rbio(ssl.get())) != 1)
+    throw std::system_error(ENOPROTOOPT, std::generic_category(), "kernel TLS unavailable");
+  // The keys now live in the kernel. The session is freed without a close_notify, which the
+  // socket would have to send through the kernel.
+}
+
+bool TlsContext::kernel_supported(void) {
+  std::ifstream ulp("/proc/sys/net/ipv4/tcp_available_ulp");
+  std::string available((std::istreambuf_iterator<char>(ulp)), std::istreambuf_iterator<char>());
+  return available.find("tls") != std::string::npos;
+}
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -0,0 +1,119 @@
+#include "socket/write_buffer.hpp"
+
+namespace wrapper {
+namespace socket {
+
+WriteBuffer::WriteBuffer(Reactor& reactor, Bidirectional& connection, WriteWatermarks watermarks,
+    uint32_t interest, bool edge_triggered) : reactor(reactor), connection(connection),
+    interest(interest), edge_triggered(edge_triggered), watermarks(std::move(watermarks)),
+    size(0), above_high(false), armed(false) {
+  if (this->watermarks.low > this->watermarks.high)
+    throw std::invalid_argument("low watermark above the high watermark");
+}
+
+WriteBuffer::WriteBuffer(WriteBuffer&& o) : reactor(o.reactor), connection(o.connection),
+    interest(o.interest), edge_triggered(o.edge_triggered), watermarks(std::move(o.watermarks)),
+    blocks(std::move(o.blocks)), size(o.size), above_high(o.above_high), armed(o.armed) {
+  o.size = 0;
+}
+
+bool WriteBuffer::write(const void* buf, size_t count) {
+  size_t sent = 0;
+  if (size == 0) { // nothing queued, so the data can go out directly and in order
+    iovec iov{const_cast<void*>(buf), count};
+    sent = connection.try_writev(&iov, 1);
+    if (sent == count)
+      return !above_high;
+  }
+  append(&((const char*) buf)[sent], count - sent);
+  arm(true);
+  if (!above_high && size >= watermarks.high) {
+    above_high = true;
+    if (watermarks.on_high)
+      watermarks.on_high();
+  }
+  return !above_high;
+}
+
+void WriteBuffer::flush(void) {
+  const size_t max_iov = 64;
+  while (size > 0) {
+    iovec iov[max_iov];
+    size_t n = 0;
+    for (auto it = blocks.begin(); it != blocks.end() && n < max_iov; it++)
+      iov[n++] = {&it->data[it->begin], it->end - it->begin};
+    size_t sent = connection.try_writev(iov, n);
+    if (sent == 0)
+      break;
+    consume(sent);
+  }
+  if (size == 0)
+    arm(false);
+  if (above_high && size <= watermarks.low) {
+    above_high = false;
+    if (watermarks.on_low)
+      watermarks.on_low();
+  }
+}
+
+size_t WriteBuffer::pending(void) const noexcept {
+  return size;
+}
+
+void WriteBuffer::set_interest(uint32_t interest) {
+  if (this->interest == interest)
+    return;
+  this->interest = interest;
+  reactor.modify(connection, armed ? interest | EPOLLOUT : interest, edge_triggered);
+}
+
+void WriteBuffer::set_edge_triggered(bool edge_triggered) {
+  if (this->edge_triggered == edge_triggered)
+    return;
+  this->edge_triggered = edge_triggered;
+  reactor.modify(connection, armed ? interest | EPOLLOUT : interest, edge_triggered);
+}
+
+void WriteBuffer::append(const char* buf, size_t count) {
+  size += count;
+  if (!blocks.empty()) {
+    Block& tail = blocks.back();
+    size_t n = std::min(count, tail.capacity - tail.end);
+    std::memcpy(&tail.data[tail.end], buf, n);
+    tail.end += n;
+    buf += n;
+    count -= n;
+  }
+  if (count > 0) {
+    size_t capacity = std::max(count, BLOCK_SIZE);
+    blocks.push_back(Block{std::make_unique<char[]>(capacity), capacity, 0, count});
+    std::memcpy(blocks.back().data.get(), buf, count);
+  }
+}
+
+void WriteBuffer::consume(size_t count) {
+  size -= count;
+  while (count > 0) {
+    Block& head = blocks.front();
+    size_t n = std::min(count, head.end - head.begin);
+    head.begin += n;
+    count -= n;
+    if (head.begin < head.end)
+      continue;
+    // The last block is kept for the next write unless it was sized for one large write.
+    if (blocks.size() == 1 && head.capacity == BLOCK_SIZE)
+      head.begin = head.end = 0;
+    else
+      blocks.pop_front();
+  }
+}
+
+void WriteBuffer::arm(bool writable) {
+  if (armed == writable)
+    return;
+  armed = writable;
+  reactor.modify(connection, writable ? interest | EPOLLOUT : interest, edge_triggered);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,110 @@
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+#include "socket/address.hpp"
+
+namespace wrapper {
+namespace socket {
+
+TEST(Address, V4) {
+  Address a("127.0.0.1", 8888);
+  EXPECT_EQ(AF_INET, a.family());
+  EXPECT_EQ("127.0.0.1", a.ip());
+  EXPECT_EQ(8888, a.port());
+  EXPECT_EQ(sizeof(sockaddr_in), a.get_sockaddr_size());
+  const sockaddr_in* addr = reinterpret_cast<const sockaddr_in*>(a.get_sockaddr());
+  EXPECT_EQ(htonl(INADDR_LOOPBACK), addr->sin_addr.s_addr);
+  EXPECT_EQ(htons(8888), addr->sin_port);
+  EXPECT_EQ(a, Address(*addr));
+}
+
+TEST(Address, V6) {
+  Address a("::1", 8888);
+  EXPECT_EQ(AF_INET6, a.family());
+  EXPECT_EQ("::1", a.ip());
+  EXPECT_EQ(8888, a.port());
+  EXPECT_EQ(sizeof(sockaddr_in6), a.get_sockaddr_size());
+  sockaddr_in6 addr = *reinterpret_cast<const sockaddr_in6*>(a.get_sockaddr());
+  addr.sin6_flowinfo = 1; // not part of the address
+  EXPECT_EQ(a, Address((sockaddr*) &addr, sizeof(sockaddr_in6)));
+}
+
+TEST(Address, Invalid) {
+  EXPECT_THROW(Address("localhost", 8888), std::runtime_error);
+  EXPECT_THROW(Address("256.0.0.1", 8888), std::runtime_error);
+  sockaddr addr{};
+  addr.sa_family = AF_PACKET;
+  EXPECT_THROW(Address(&addr, sizeof(sockaddr)), std::runtime_error);
+  EXPECT_THROW(Address::local_path(""), std::runtime_error);
+  EXPECT_THROW(Address::local_path(std::string(200, 'a')), std::runtime_error);
+  const size_t max_abstract = sizeof(sockaddr_un::sun_path) - 2; // after the 0, before the end
+  EXPECT_EQ("@" + std::string(max_abstract, 'a'),
+      Address::local_abstract(std::string(max_abstract, 'a')).path());
+  EXPECT_THROW(Address::local_abstract(std::string(max_abstract + 1, 'a')), std::runtime_error);
+}
+
+TEST(Address, Local) {
+  Address path = Address::local_path("/tmp/socket");
+  EXPECT_EQ(AF_UNIX, path.family());
+  EXPECT_EQ("/tmp/socket", path.path());
+  EXPECT_EQ("", path.ip());
+  EXPECT_EQ(0, path.port());
+  EXPECT_EQ(path, Address(path.get_sockaddr(), path.get_sockaddr_size()));
+  Address abstract = Address::local_abstract("socket");
+  EXPECT_EQ("@socket", abstract.path());
+  EXPECT_EQ(offsetof(sockaddr_un, sun_path) + 7, abstract.get_sockaddr_size());
+  EXPECT_EQ(abstract, Address(abstract.get_sockaddr(), abstract.get_sockaddr_size()));
+  EXPECT_NE(path, abstract);
+  Address unnamed = Address::local_abstract("");
+  EXPECT_EQ("", unnamed.path());
+  EXPECT_EQ(sizeof(sa_family_t), unnamed.get_sockaddr_size());
+  EXPECT_EQ(unnamed, Address(unnamed.get_sockaddr(), unnamed.get_sockaddr_size()));
+}
+
+TEST(Address, LocalPadded) {
+  // Some peers bind abstract names with the whole of sun_path, padded with 0 bytes.
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path + 1, "socket", 6);
+  Address padded((sockaddr*) &addr, sizeof(sockaddr_un));
+  EXPECT_EQ(sizeof(sockaddr_un), padded.get_sockaddr_size());
+  EXPECT_EQ("@socket" + std::string(sizeof(addr.sun_path) - 7, '\0'), padded.path());
+  EXPECT_EQ(padded, Address(padded.get_sockaddr(), padded.get_sockaddr_size()));
+  EXPECT_NE(Address::local_abstract("socket"), padded);
+  addr.sun_path[3] = '\0'; // a 0 inside the name
+  Address split((sockaddr*) &addr, offsetof(sockaddr_un, sun_path) + 7);
+  EXPECT_EQ(std::string("@so\0ket", 7), split.path());
+}
+
+TEST(Address, Compare) {
+  EXPECT_EQ(Address("10.0.0.1", 1), Address("10.0.0.1", 1));
+  EXPECT_NE(Address("10.0.0.1", 1), Address("10.0.0.1", 2));
+  EXPECT_NE(Address("10.0.0.1", 1), Address("10.0.0.2", 1));
+  EXPECT_NE(Address("::ffff:10.0.0.1", 1), Address("10.0.0.1", 1));
+  EXPECT_EQ(Address(), Address());
+}
+
+TEST(Address, Hash) {
+  std::unordered_map<Address, int> peers;
+  for (int i = 0; i < 100; i++)
+    peers[Address("10.0.0." + std::to_string(i), 80)] = i;
+  peers[Address("fe80::1", 80)] = 100;
+  EXPECT_EQ(101, peers.size());
+  EXPECT_EQ(42, peers.at(Address("10.0.0.42", 80)));
+  EXPECT_EQ(100, peers.at(Address("fe80::1", 80)));
+  EXPECT_EQ(std::hash<Address>()(Address("10.0.0.1", 1)),
+      std::hash<Address>()(Address("10.0.0.1", 1)));
+}
+
+TEST(Address, Print) {
+  std::ostringstream os;
+  os << Address("127.0.0.1", 8888) << " " << Address("::1", 8888) << " " <<
+      Address::local_abstract("socket");
+  EXPECT_EQ("127.0.0.1:8888 [::1]:8888 unix:@socket", os.str());
+}
+
+} // namespace socket
+} // namespace wrapper
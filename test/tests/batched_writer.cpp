@@ -0,0 +1,107 @@
+#include <future>
+
+#include "gtest/gtest.h"
+#include "socket/batched_writer.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(BatchedWriter, Flush) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BatchedWriter w(*out, 64);
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t network_format = htonl(i);
+    w.write(&network_format, sizeof(uint32_t));
+  }
+  EXPECT_EQ(4 * sizeof(uint32_t), w.pending());
+  usleep(1000);
+  EXPECT_FALSE(in.data_available());
+  w.flush();
+  EXPECT_EQ(0, w.pending());
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t output;
+    in.read(&output, sizeof(uint32_t));
+    EXPECT_EQ(i, ntohl(output));
+  }
+}
+
+TEST(BatchedWriter, Threshold) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BatchedWriter w(*out, 4 * sizeof(uint32_t));
+  for (uint32_t input = 0; input < 0xabcd; input++) {
+    uint32_t network_format = htonl(input);
+    w.write(&network_format, sizeof(uint32_t));
+    if (input % 4 == 3) {
+      EXPECT_EQ(0, w.pending());
+      for (uint32_t i = input - 3; i <= input; i++) {
+        uint32_t output;
+        in.read(&output, sizeof(uint32_t));
+        EXPECT_EQ(i, ntohl(output));
+      }
+    }
+  }
+}
+
+TEST(BatchedWriter, LargeWrite) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BatchedWriter w(*out, 16);
+  char small = 'a';
+  w.write(&small, sizeof(char));
+  std::vector<char> large(100, 'b');
+  w.write(large.data(), large.size());
+  EXPECT_EQ(0, w.pending());
+  std::vector<char> received(large.size() + 1);
+  in.read(received.data(), received.size());
+  EXPECT_EQ(small, received[0]);
+  EXPECT_TRUE(std::equal(large.begin(), large.end(), received.begin() + 1));
+}
+
+TEST(BatchedWriter, DestructorFlushes) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  {
+    BatchedWriter w(*out);
+    uint32_t network_format = htonl(123);
+    w.write(&network_format, sizeof(uint32_t));
+  }
+  uint32_t output;
+  ASSERT_TRUE(in.read(&output, sizeof(uint32_t), 1000));
+  EXPECT_EQ(123, ntohl(output));
+}
+
+TEST(BatchedWriter, FailedSendKeepsUnsent) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  std::unique_ptr<Connected> in = std::make_unique<Connected>(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> closer = std::async(std::launch::async, [&in] (void) {
+        char first;
+        in->read(&first, sizeof(char));
+        in.reset(); // closing with unread data resets the connection mid-send
+      });
+  BatchedWriter w(*out, 16);
+  char small = 'a';
+  w.write(&small, sizeof(char));
+  std::vector<char> large(64 << 20, 'b');
+  EXPECT_THROW(w.write(large.data(), large.size()), std::system_error);
+  closer.get();
+  // What went out before the reset is not pending again, the rest of large is.
+  EXPECT_GT(w.pending(), sizeof(char));
+  EXPECT_LE(w.pending(), large.size());
+}
+
+} // namespace socket
+} // namespace wrapper
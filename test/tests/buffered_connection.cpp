@@ -0,0 +1,116 @@
+#include <future>
+
+#include "gtest/gtest.h"
+#include "socket/buffered_connection.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(BufferedConnection, Capacity) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  outF.get();
+  EXPECT_THROW(BufferedConnection(in, 0), std::invalid_argument);
+  EXPECT_THROW(BufferedConnection(in, 100), std::invalid_argument);
+  BufferedConnection b(in, 128);
+  EXPECT_EQ(0, b.buffered());
+}
+
+TEST(BufferedConnection, ReadExact) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferedConnection b(in, 64); // small enough to wrap around
+  std::vector<uint32_t> batch(100);
+  for (uint32_t input = 0; input < 0xabcd; input += batch.size()) {
+    for (uint32_t i = 0; i < batch.size(); i++)
+      batch[i] = htonl(input + i);
+    out->write(batch.data(), batch.size() * sizeof(uint32_t));
+    for (uint32_t i = 0; i < batch.size(); i++) {
+      uint32_t output;
+      ASSERT_TRUE(b.read_exact(&output, sizeof(uint32_t)));
+      EXPECT_EQ(input + i, ntohl(output));
+    }
+  }
+  EXPECT_EQ(0, b.buffered());
+}
+
+TEST(BufferedConnection, ReadLargerThanCapacity) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferedConnection b(in, 16);
+  std::vector<char> input(1000);
+  for (size_t i = 0; i < input.size(); i++)
+    input[i] = i;
+  out->write(input.data(), input.size());
+  char first;
+  ASSERT_TRUE(b.read_exact(&first, sizeof(char)));
+  EXPECT_EQ(input[0], first);
+  std::vector<char> output(input.size() - 1);
+  ASSERT_TRUE(b.read_exact(output.data(), output.size()));
+  EXPECT_TRUE(std::equal(output.begin(), output.end(), input.begin() + 1));
+}
+
+TEST(BufferedConnection, Peek) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferedConnection b(in, 16);
+  uint32_t network_format = htonl(123);
+  out->write(&network_format, sizeof(uint32_t));
+  uint32_t output = 0;
+  ASSERT_TRUE(b.peek(&output, sizeof(uint32_t)));
+  EXPECT_EQ(123, ntohl(output));
+  EXPECT_EQ(sizeof(uint32_t), b.buffered());
+  output = 0;
+  ASSERT_TRUE(b.read_exact(&output, sizeof(uint32_t)));
+  EXPECT_EQ(123, ntohl(output));
+  EXPECT_THROW(b.peek(&output, 17), std::length_error);
+}
+
+TEST(BufferedConnection, ReadUntil) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferedConnection b(in, 16);
+  std::string input("first\nsecond line\nthird\n");
+  out->write(input.data(), input.size());
+  char line[16];
+  ASSERT_EQ(6, b.read_until(line, sizeof(line), '\n'));
+  EXPECT_EQ("first\n", std::string(line, 6));
+  ASSERT_EQ(12, b.read_until(line, sizeof(line), '\n'));
+  EXPECT_EQ("second line\n", std::string(line, 12));
+  ASSERT_EQ(6, b.read_until(line, sizeof(line), '\n'));
+  EXPECT_EQ("third\n", std::string(line, 6));
+  EXPECT_EQ(0, b.read_until(line, sizeof(line), '\n', 10));
+  input = "no delimiter here";
+  out->write(input.data(), input.size());
+  EXPECT_THROW(b.read_until(line, sizeof(line), '\n'), std::length_error);
+}
+
+TEST(BufferedConnection, PartialTimeout) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferedConnection b(in, 16);
+  uint32_t network_format = htonl(0x61626364);
+  out->write(&network_format, 1);
+  uint32_t output;
+  EXPECT_FALSE(b.read_exact(&output, sizeof(uint32_t), 10));
+  EXPECT_EQ(1, b.buffered()); // nothing is lost on timeout
+  out->write(&((char*) &network_format)[1], sizeof(uint32_t) - 1);
+  ASSERT_TRUE(b.read_exact(&output, sizeof(uint32_t), 1000));
+  EXPECT_EQ(0x61626364, ntohl(output));
+}
+
+} // namespace socket
+} // namespace wrapper
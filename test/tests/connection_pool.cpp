@@ -0,0 +1,106 @@
+#include <future>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "socket/connection_pool.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(ConnectionPool, ConstructDestruct) {
+  ConnectionPool p;
+  EXPECT_THROW(ConnectionPool(0), std::invalid_argument);
+}
+
+TEST(ConnectionPool, Reuse) {
+  Listening s(PORT);
+  ConnectionPool p;
+  Address local = [&] (void) {
+        ConnectionPool::Lease l(p.acquire(s.get_address()));
+        EXPECT_TRUE(l);
+        return l->get_address();
+      }();
+  EXPECT_EQ(1, p.idle(s.get_address()));
+  ConnectionPool::Lease l(p.acquire(s.get_address()));
+  EXPECT_EQ(local, l->get_address());
+  EXPECT_EQ(0, p.idle(s.get_address()));
+  EXPECT_EQ(1, p.open(s.get_address()));
+  std::unique_ptr<Bidirectional> out(s.accept(0));
+  EXPECT_NE(nullptr, out);
+  EXPECT_EQ(nullptr, s.accept(0)); // connected only once
+}
+
+TEST(ConnectionPool, Cap) {
+  Listening s(PORT);
+  ConnectionPool p(2);
+  ConnectionPool::Lease l1(p.acquire(s.get_address()));
+  ConnectionPool::Lease l2(p.acquire(s.get_address()));
+  EXPECT_NE(l1->get_address(), l2->get_address());
+  EXPECT_FALSE(p.acquire(s.get_address(), 10));
+  EXPECT_FALSE(p.acquire(s.get_address(), 0));
+  std::future<void> releaseF = std::async(std::launch::async, [&l1] (void) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ConnectionPool::Lease released(std::move(l1));
+      });
+  ConnectionPool::Lease l3(p.acquire(s.get_address()));
+  EXPECT_TRUE(l3);
+  releaseF.get();
+  EXPECT_EQ(2, p.open(s.get_address()));
+}
+
+TEST(ConnectionPool, Discard) {
+  Listening s(PORT);
+  ConnectionPool p;
+  {
+    ConnectionPool::Lease l(p.acquire(s.get_address()));
+    l.discard();
+  }
+  EXPECT_EQ(0, p.idle(s.get_address()));
+  EXPECT_EQ(0, p.open(s.get_address()));
+}
+
+TEST(ConnectionPool, ClosedByPeer) {
+  Listening s(PORT);
+  ConnectionPool p;
+  Address local = [&] (void) {
+        ConnectionPool::Lease l(p.acquire(s.get_address()));
+        return l->get_address();
+      }();
+  s.accept(); // the peer closes the idle socket
+  std::this_thread::sleep_for(std::chrono::milliseconds(10)); // let the FIN arrive
+  ConnectionPool::Lease l(p.acquire(s.get_address()));
+  EXPECT_NE(local, l->get_address());
+  EXPECT_EQ(1, p.open(s.get_address()));
+}
+
+TEST(ConnectionPool, ConnectFailure) {
+  ConnectionPool p(1);
+  Address nobody("127.0.0.1", PORT);
+  EXPECT_THROW(p.acquire(nobody), std::system_error);
+  EXPECT_EQ(0, p.open(nobody));
+}
+
+TEST(ConnectionPool, Threads) {
+  const size_t n_threads = 8;
+  const uint32_t n_requests = 100;
+  Listening s(PORT);
+  ConnectionPool p(4);
+  std::vector<std::future<void>> clients;
+  for (size_t t = 0; t < n_threads; t++)
+    clients.emplace_back(std::async(std::launch::async, [&] (void) {
+          for (uint32_t i = 0; i < n_requests; i++) {
+            ConnectionPool::Lease l(p.acquire(s.get_address()));
+            uint32_t network_format = htonl(i);
+            l->write(&network_format, sizeof(uint32_t));
+          }
+        }));
+  for (auto& c : clients)
+    c.get();
+  EXPECT_GE(4, p.open(s.get_address()));
+  EXPECT_EQ(p.open(s.get_address()), p.idle(s.get_address()));
+}
+
+} // namespace socket
+} // namespace wrapper
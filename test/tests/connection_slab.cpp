@@ -0,0 +1,92 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "gtest/gtest.h"
+#include "socket/connection_slab.hpp"
+
+#define PORT 8888
+
+// Counts heap allocations made by the whole test binary while enabled. The replacements apply to
+// every test, and none of them is inlined, so the compiler cannot pair the malloc and free inside
+// them and every new expression reaches the counter.
+static std::atomic<bool> counting(false);
+static std::atomic<size_t> allocations(0);
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  if (counting)
+    allocations++;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+namespace wrapper {
+namespace socket {
+
+TEST(ConnectionSlab, AcceptRelease) {
+  Listening s(PORT);
+  ConnectionSlab slab(2);
+  EXPECT_EQ(2, slab.get_capacity());
+  Connected c1(s.get_address());
+  Connected c2(s.get_address());
+  Connected c3(s.get_address());
+  ConnectionSlab::Connection b1 = slab.accept(s, 1000);
+  ConnectionSlab::Connection b2 = slab.accept(s, 1000);
+  ASSERT_TRUE(b1);
+  ASSERT_TRUE(b2);
+  EXPECT_EQ(2, slab.size());
+  EXPECT_FALSE(slab.accept(s, 1000)); // full, c3 stays in the backlog
+  uint32_t message = 42;
+  b1->write(&message, sizeof(uint32_t));
+  message = 0;
+  c1.read(&message, sizeof(uint32_t));
+  EXPECT_EQ(42, message);
+  EXPECT_EQ(c1.get_local_address(), b1->get_input_address());
+  Bidirectional* first = b1.get();
+  b1.reset();
+  EXPECT_EQ(1, slab.size());
+  EXPECT_THROW(c1.read(&message, sizeof(uint32_t)), std::system_error);
+  ConnectionSlab::Connection b3 = slab.accept(s, 1000);
+  ASSERT_TRUE(b3);
+  EXPECT_EQ(first, b3.get()); // the slot is reused
+  EXPECT_EQ(c3.get_local_address(), b3->get_input_address());
+}
+
+TEST(ConnectionSlab, Timeout) {
+  Listening s(PORT);
+  ConnectionSlab slab(1);
+  EXPECT_FALSE(slab.accept(s, 10));
+  EXPECT_EQ(0, slab.size());
+}
+
+TEST(ConnectionSlab, NoAllocations) {
+  Listening s(PORT);
+  ConnectionSlab slab(4);
+  for (int i = 0; i < 2; i++) { // warm up anything allocated on first use
+    Connected c(s.get_address());
+    slab.accept(s, 1000, true);
+  }
+  counting = true;
+  for (int i = 0; i < 100; i++) {
+    Connected c(s.get_address());
+    ConnectionSlab::Connection b = slab.accept(s, 1000, true);
+    if (!b)
+      counting = false; // reporting the failure allocates
+    ASSERT_TRUE(b);
+  }
+  counting = false;
+  EXPECT_EQ(0, allocations);
+  EXPECT_EQ(0, slab.size());
+}
+
+} // namespace socket
+} // namespace wrapper
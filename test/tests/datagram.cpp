@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+#include "socket/datagram.hpp"
+
+namespace wrapper {
+namespace socket {
+
+TEST(Datagram, ConstructDestruct) {
+  Datagram d;
+  EXPECT_NE(0, d.get_address().port());
+}
+
+TEST(Datagram, Timeout) {
+  Datagram d;
+  char buf[64];
+  Datagram::Message m{buf, sizeof(buf)};
+  EXPECT_EQ(0, d.recv_batch(&m, 1, 10));
+  EXPECT_EQ(0, d.recv_batch(&m, 1, 0));
+}
+
+TEST(Datagram, Batch) {
+  const uint32_t n_messages = 64;
+  Datagram in, out;
+  std::vector<uint32_t> input(n_messages), output(n_messages);
+  std::vector<Datagram::Message> messages(n_messages);
+  for (uint32_t i = 0; i < n_messages; i++) {
+    input[i] = htonl(i);
+    messages[i] = Datagram::Message{&input[i], sizeof(uint32_t), in.get_address()};
+  }
+  out.send_batch(messages.data(), n_messages);
+  for (uint32_t i = 0; i < n_messages; i++)
+    messages[i] = Datagram::Message{&output[i], sizeof(uint32_t)};
+  size_t received = 0;
+  while (received < n_messages) {
+    size_t ret = in.recv_batch(&messages[received], n_messages - received, 1000);
+    ASSERT_NE(0, ret);
+    for (size_t i = received; i < received + ret; i++) {
+      EXPECT_EQ(sizeof(uint32_t), messages[i].size);
+      EXPECT_EQ(out.get_address().port(), messages[i].address.port());
+    }
+    received += ret;
+  }
+  for (uint32_t i = 0; i < n_messages; i++)
+    EXPECT_EQ(i, ntohl(output[i]));
+}
+
+TEST(Datagram, Truncated) {
+  Datagram in, out;
+  char input[64] = "datagram";
+  Datagram::Message m{input, sizeof(input), in.get_address()};
+  out.send_batch(&m, 1);
+  char output[4];
+  m = Datagram::Message{output, sizeof(output)};
+  ASSERT_EQ(1, in.recv_batch(&m, 1, 1000));
+  EXPECT_EQ(sizeof(output), m.size);
+  EXPECT_EQ(0, std::memcmp(input, output, sizeof(output)));
+}
+
+TEST(Datagram, Segmented) {
+  const uint16_t segment_size = 100;
+  const size_t n_segments = 10;
+  Datagram in, out;
+  std::vector<char> input(segment_size * n_segments - 50); // the last segment is shorter
+  for (size_t i = 0; i < input.size(); i++)
+    input[i] = i / segment_size;
+  Datagram::Message m{input.data(), input.size(), in.get_address(), segment_size};
+  try {
+    out.send_batch(&m, 1);
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "UDP GSO is not supported: " << e.what();
+  }
+  std::vector<char> output(segment_size * n_segments);
+  std::vector<Datagram::Message> messages(n_segments);
+  for (size_t i = 0; i < n_segments; i++)
+    messages[i] = Datagram::Message{&output[i * segment_size], segment_size};
+  size_t received = 0;
+  while (received < n_segments) {
+    size_t ret = in.recv_batch(&messages[received], n_segments - received, 1000);
+    ASSERT_NE(0, ret);
+    received += ret;
+  }
+  EXPECT_EQ(segment_size / 2, messages.back().size);
+  output.resize(input.size());
+  EXPECT_EQ(input, output);
+}
+
+TEST(Datagram, Coalesced) {
+  const uint16_t segment_size = 100;
+  const size_t n_segments = 10;
+  Datagram in, out;
+  if (!in.enable_gro())
+    GTEST_SKIP() << "UDP GRO is not supported";
+  std::vector<char> input(segment_size * n_segments);
+  for (size_t i = 0; i < input.size(); i++)
+    input[i] = i / segment_size;
+  Datagram::Message m{input.data(), input.size(), in.get_address(), segment_size};
+  try {
+    out.send_batch(&m, 1);
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "UDP GSO is not supported: " << e.what();
+  }
+  std::vector<char> output(input.size());
+  size_t received = 0;
+  while (received < output.size()) {
+    m = Datagram::Message{&output[received], output.size() - received};
+    ASSERT_EQ(1, in.recv_batch(&m, 1, 1000));
+    if (m.segment_size != 0) {
+      EXPECT_EQ(segment_size, m.segment_size);
+    }
+    received += m.size;
+  }
+  EXPECT_EQ(input, output);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,161 @@
+#include <sys/resource.h>
+
+#include "gtest/gtest.h"
+#include "socket/io_engine.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(IoEngine, ConstructDestruct) {
+  IoEngine e;
+  EXPECT_EQ(0, e.run_once(10));
+}
+
+// CI builds with SOCKET_TESTS_EXPECT_IO_URING where io_uring must be used, so a silent fallback to
+// epoll fails there.
+TEST(IoEngine, Backend) {
+  IoEngine e;
+#if defined(SOCKET_EXPECT_IO_URING)
+  EXPECT_TRUE(e.uses_io_uring());
+#elif !defined(SOCKET_HAVE_IO_URING)
+  EXPECT_FALSE(e.uses_io_uring());
+#endif
+}
+
+TEST(IoEngine, BufferCount) {
+  EXPECT_THROW(IoEngine(256, 0), std::invalid_argument);
+  EXPECT_THROW(IoEngine(256, 100), std::invalid_argument);
+}
+
+TEST(IoEngine, Echo) {
+  const size_t n_connections = 8;
+  IoEngine e;
+  Listening s(PORT);
+  std::vector<std::unique_ptr<Bidirectional>> accepted;
+  e.accept(s, [&] (std::unique_ptr<Bidirectional> b) {
+        Bidirectional& connection = *b;
+        accepted.push_back(std::move(b));
+        e.receive(connection, [&e, &connection] (const char* data, size_t count) {
+              if (count == 0)
+                return e.remove(connection);
+              // The receive buffer is recycled once the handler returns.
+              char* copy = new char[count];
+              std::memcpy(copy, data, count);
+              e.send(connection, copy, count, [copy] (int error) {
+                    EXPECT_EQ(0, error);
+                    delete[] copy;
+                  });
+            });
+      });
+  std::vector<std::unique_ptr<Bidirectional>> in;
+  for (size_t n = 0; n < n_connections; n++)
+    in.emplace_back(std::make_unique<Bidirectional>(s.get_address()));
+  for (uint32_t input = 0; input < 256; input++) {
+    uint32_t network_format = htonl(input);
+    for (auto& i : in)
+      i->write(&network_format, sizeof(uint32_t));
+    for (auto& i : in) {
+      uint32_t output;
+      while (!i->read(&output, sizeof(uint32_t), 0))
+        e.run_once(1000);
+      EXPECT_EQ(input, ntohl(output));
+    }
+  }
+  EXPECT_EQ(n_connections, accepted.size());
+  in.clear();
+  for (int i = 0; i < 10; i++)
+    e.run_once(10); // observe every close
+  e.remove(s);
+}
+
+TEST(IoEngine, SendsInOrder) {
+  const uint32_t n_sends = 1024;
+  IoEngine e;
+  Listening s(PORT);
+  std::unique_ptr<Bidirectional> out;
+  e.accept(s, [&out] (std::unique_ptr<Bidirectional> b) { out = std::move(b); });
+  Connected in(s.get_address());
+  while (!out)
+    e.run_once(1000);
+  std::vector<uint32_t> messages(n_sends);
+  uint32_t completed = 0;
+  for (uint32_t i = 0; i < n_sends; i++) {
+    messages[i] = htonl(i);
+    e.send(*out, &messages[i], sizeof(uint32_t), [&completed, i] (int error) {
+          EXPECT_EQ(0, error);
+          EXPECT_EQ(i, completed++);
+        });
+  }
+  while (completed < n_sends)
+    e.run_once(1000);
+  for (uint32_t i = 0; i < n_sends; i++) {
+    uint32_t output;
+    in.read(&output, sizeof(uint32_t));
+    EXPECT_EQ(i, ntohl(output));
+  }
+  e.remove(*out);
+  e.remove(s);
+}
+
+TEST(IoEngine, Remove) {
+  IoEngine e;
+  Listening s(PORT);
+  e.accept(s, [] (std::unique_ptr<Bidirectional>) { FAIL(); });
+  e.remove(s);
+  EXPECT_THROW(e.remove(s), std::invalid_argument);
+  Connected in(s.get_address());
+  EXPECT_EQ(0, e.run_once(10));
+}
+
+TEST(IoEngine, RemoveThenDestroy) {
+  IoEngine e;
+  {
+    Listening s(PORT);
+    e.accept(s, [] (std::unique_ptr<Bidirectional>) { FAIL(); });
+    Connected in(s.get_address());
+    e.remove(s);
+  }
+  for (int i = 0; i < 10; i++) // late completions must not touch the listener
+    EXPECT_EQ(0, e.run_once(10));
+}
+
+// The connection waits in the backlog while no descriptor is free, which must not make every
+// run_once fail.
+TEST(IoEngine, OutOfDescriptors) {
+  IoEngine e;
+  Listening s(PORT);
+  std::unique_ptr<Bidirectional> out;
+  e.accept(s, [&out] (std::unique_ptr<Bidirectional> b) { out = std::move(b); });
+  rlimit limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+  Connected in(s.get_address());
+  int next_fd = dup(0);
+  ::close(next_fd);
+  rlimit lowered = limit;
+  lowered.rlim_cur = next_fd; // no room for the accepted socket
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &lowered));
+  size_t failures = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (std::chrono::steady_clock::now() < deadline) {
+    try {
+      e.run_once(10);
+    } catch (const std::system_error& err) {
+      EXPECT_EQ(EMFILE, err.code().value());
+      failures++;
+    }
+  }
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &limit));
+  EXPECT_FALSE(out);
+  EXPECT_GE(failures, 1);
+  EXPECT_LE(failures, 5); // once per backoff
+  auto accepted = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (!out && std::chrono::steady_clock::now() < accepted)
+    e.run_once(10);
+  EXPECT_TRUE(out);
+  e.remove(s);
+}
+
+} // namespace socket
+} // namespace wrapper
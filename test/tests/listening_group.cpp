@@ -0,0 +1,66 @@
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "socket/listening_group.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(ListeningGroup, ConstructDestruct) {
+  ListeningGroup g(PORT, 4);
+  EXPECT_EQ(4, g.size());
+  EXPECT_EQ(g[0].get_address(), g[3].get_address());
+  EXPECT_THROW(g[4], std::out_of_range);
+}
+
+TEST(ListeningGroup, Empty) {
+  EXPECT_THROW(ListeningGroup(PORT, 0), std::invalid_argument);
+}
+
+TEST(ListeningGroup, ExclusiveWithPlainListener) {
+  Listening s(PORT);
+  EXPECT_THROW(ListeningGroup(PORT, 2), std::exception);
+}
+
+TEST(ListeningGroup, AcceptAcrossListeners) {
+  const size_t n_connections = 64;
+  ListeningGroup g(PORT, 4);
+  std::vector<std::unique_ptr<Connected>> in;
+  for (size_t n = 0; n < n_connections; n++)
+    in.emplace_back(std::make_unique<Connected>(g.get_address()));
+  size_t accepted = 0;
+  for (size_t i = 0; i < g.size(); i++)
+    accepted += g[i].accept_batch(n_connections, 100).size();
+  EXPECT_EQ(n_connections, accepted);
+}
+
+TEST(ListeningGroup, Pin) {
+  ListeningGroup g(PORT, 2);
+  for (size_t i = 0; i < g.size(); i++) {
+    // Pinned on a thread of its own, so the rest of the tests keep running unpinned.
+    std::thread pinned([&g, i] (void) {
+          cpu_set_t allowed;
+          ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &allowed));
+          std::vector<int> cpus; // the allowed set may have gaps, as in a cpuset
+          for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed))
+              cpus.push_back(cpu);
+          int expected = cpus[i % cpus.size()];
+          g.pin(i);
+          cpu_set_t set;
+          ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set));
+          EXPECT_EQ(1, CPU_COUNT(&set));
+          EXPECT_TRUE(CPU_ISSET(expected, &set));
+          EXPECT_EQ(expected, sched_getcpu());
+          EXPECT_EQ(expected, g[i].get_option(SOL_SOCKET, SO_INCOMING_CPU));
+        });
+    pinned.join();
+  }
+}
+
+} // namespace socket
+} // namespace wrapper
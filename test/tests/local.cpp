@@ -0,0 +1,101 @@
+#include <future>
+
+#include "gtest/gtest.h"
+#include "socket/socket.hpp"
+
+#define NAME "socket-test"
+
+namespace wrapper {
+namespace socket {
+
+TEST(Local, Abstract) {
+  Listening s(Address::local_abstract(NAME));
+  EXPECT_EQ("@" NAME, s.get_address().path());
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  EXPECT_EQ(s.get_address(), in.get_input_address());
+  EXPECT_EQ(AF_UNIX, out->get_input_address().family());
+  uint32_t message = 42;
+  out->write(&message, sizeof(uint32_t));
+  message = 0;
+  in.read(&message, sizeof(uint32_t));
+  EXPECT_EQ(42, message);
+  in.write(&message, sizeof(uint32_t));
+  message = 0;
+  EXPECT_TRUE(out->read(&message, sizeof(uint32_t), 1000));
+  EXPECT_EQ(42, message);
+}
+
+TEST(Local, Path) {
+  std::string path = "/tmp/socket-test-" + std::to_string(getpid());
+  {
+    Listening s(Address::local_path(path));
+    EXPECT_EQ(0, access(path.c_str(), F_OK));
+    EXPECT_THROW(Listening(Address::local_path(path)), std::system_error);
+    std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+    Connected in(s.get_address());
+    outF.get();
+  }
+  EXPECT_EQ(-1, access(path.c_str(), F_OK)); // unlinked with the listener
+}
+
+TEST(Local, Autobind) {
+  Listening s(Address::local_abstract(""));
+  EXPECT_EQ('@', s.get_address().path()[0]);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  outF.get();
+}
+
+TEST(Local, SeqPacket) {
+  SocketOptions options;
+  options.seqpacket = true;
+  Listening s(Address::local_abstract(NAME), options);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address(), options);
+  std::unique_ptr<Bidirectional> out = outF.get();
+  out->write("abcdef", 6);
+  out->write("gh", 2);
+  char message[4] = {};
+  in.read(message, 4); // the rest of the first message is discarded
+  EXPECT_EQ(std::string("abcd"), std::string(message, 4));
+  in.read(message, 2);
+  EXPECT_EQ(std::string("gh"), std::string(message, 2));
+}
+
+TEST(Local, SocketPair) {
+  auto pair = socket_pair();
+  uint32_t message = 42;
+  pair.first->write(&message, sizeof(uint32_t));
+  message = 0;
+  pair.second->read(&message, sizeof(uint32_t));
+  EXPECT_EQ(42, message);
+  pair.first.reset();
+  EXPECT_THROW(pair.second->read(&message, sizeof(uint32_t)), std::system_error);
+}
+
+TEST(Local, PassFds) {
+  auto pair = socket_pair();
+  int pipefd[2];
+  ASSERT_EQ(0, pipe(pipefd));
+  FileDescriptor read_end(pipefd[0]), write_end(pipefd[1]);
+  pair.first->write_fds("x", 1, &pipefd[0], 1);
+  pair.first->write_fds("yz", 2, &pipefd[1], 1);
+  std::vector<FileDescriptor> fds;
+  char message[3];
+  EXPECT_TRUE(pair.second->read_fds(message, 3, fds, 1000));
+  EXPECT_EQ(std::string("xyz"), std::string(message, 3));
+  ASSERT_EQ(2, fds.size());
+  EXPECT_EQ(1, ::write(fds[1].get(), "a", 1));
+  char c = 0;
+  EXPECT_EQ(1, ::read(read_end.get(), &c, 1));
+  EXPECT_EQ('a', c);
+  EXPECT_EQ(1, ::write(write_end.get(), "b", 1));
+  EXPECT_EQ(1, ::read(fds[0].get(), &c, 1));
+  EXPECT_EQ('b', c);
+  EXPECT_THROW(pair.first->write_fds("", 0, &pipefd[0], 1), std::invalid_argument);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,111 @@
+#include <future>
+
+#include "gtest/gtest.h"
+#include "socket/message_channel.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(BufferPool, Reuse) {
+  BufferPool p(4096);
+  char* data;
+  {
+    BufferPool::Buffer b(p.get(100));
+    EXPECT_TRUE(b);
+    EXPECT_EQ(100, b.size());
+    EXPECT_EQ(128, b.capacity());
+    data = b.data();
+  }
+  EXPECT_EQ(1, p.cached());
+  BufferPool::Buffer b(p.get(65));
+  EXPECT_EQ(data, b.data());
+  EXPECT_EQ(0, p.cached());
+  EXPECT_EQ(64, p.get(0).capacity());
+  EXPECT_EQ(4096, p.get(4096).capacity());
+  EXPECT_THROW(p.get(4097), std::length_error);
+  EXPECT_FALSE(BufferPool::Buffer());
+}
+
+TEST(BufferPool, SelfMove) {
+  BufferPool p(4096);
+  BufferPool::Buffer b(p.get(100));
+  char* data = b.data();
+  BufferPool::Buffer& alias = b;
+  b = std::move(alias);
+  EXPECT_TRUE(b);
+  EXPECT_EQ(data, b.data());
+  EXPECT_EQ(0, p.cached());
+}
+
+TEST(MessageChannel, SendReceive) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferPool p;
+  MessageChannel sender(in, p), receiver(*out, p, 1 << 20, 4096);
+  // Sizes from empty to larger than the read buffer.
+  for (uint32_t size : {0, 1, 100, 4092, 4093, 100000}) {
+    std::vector<char> input(size);
+    for (uint32_t i = 0; i < size; i++)
+      input[i] = i % 251;
+    sender.send(input.data(), size);
+    BufferPool::Buffer output(receiver.receive(1000));
+    ASSERT_TRUE(output);
+    ASSERT_EQ(size, output.size());
+    EXPECT_EQ(0, std::memcmp(input.data(), output.data(), size));
+  }
+}
+
+TEST(MessageChannel, Timeout) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferPool p;
+  MessageChannel receiver(*out, p);
+  EXPECT_FALSE(receiver.receive(10));
+  // Half a frame times out without losing the received part.
+  uint32_t header = htonl(8);
+  in.write(&header, sizeof(uint32_t));
+  in.write("abcd", 4);
+  EXPECT_FALSE(receiver.receive(10));
+  EXPECT_FALSE(receiver.receive(0));
+  in.write("efgh", 4);
+  BufferPool::Buffer output(receiver.receive(1000));
+  ASSERT_TRUE(output);
+  EXPECT_EQ("abcdefgh", std::string(output.data(), output.size()));
+}
+
+TEST(MessageChannel, MaxFrameSize) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferPool p;
+  MessageChannel sender(in, p, 16), receiver(*out, p, 8);
+  char message[16] = {};
+  EXPECT_THROW(sender.send(message, 17), std::length_error);
+  sender.send(message, 16);
+  EXPECT_THROW(receiver.receive(1000), std::length_error);
+}
+
+TEST(MessageChannel, PooledBuffers) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  BufferPool p;
+  MessageChannel sender(in, p), receiver(*out, p);
+  char message[200] = {};
+  for (int i = 0; i < 100; i++) {
+    sender.send(message, sizeof(message));
+    EXPECT_TRUE(receiver.receive());
+  }
+  EXPECT_EQ(1, p.cached()); // every receive reused the same buffer
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,142 @@
+#include <future>
+#include <sys/eventfd.h>
+
+#include "gtest/gtest.h"
+#include "socket/reactor.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(Reactor, ConstructDestruct) {
+  Reactor r;
+  EXPECT_EQ(0, r.size());
+}
+
+TEST(Reactor, Timeout) {
+  Reactor r;
+  EXPECT_EQ(0, r.poll(10));
+}
+
+TEST(Reactor, AddRemove) {
+  Reactor r;
+  Listening s(PORT);
+  r.add(s, Reactor::Handlers{});
+  EXPECT_THROW(r.add(s, Reactor::Handlers{}), std::invalid_argument);
+  EXPECT_EQ(1, r.size());
+  r.remove(s);
+  EXPECT_EQ(0, r.size());
+  EXPECT_THROW(r.remove(s), std::invalid_argument);
+}
+
+TEST(Reactor, ManyConnections) {
+  const uint32_t n_connections = 64;
+  Reactor r;
+  Listening s(PORT);
+  std::vector<std::unique_ptr<Bidirectional>> accepted;
+  uint32_t received = 0;
+  r.add(s, Reactor::Handlers{[&] (void) {
+        accepted.push_back(s.accept(0));
+        Bidirectional& b = *accepted.back();
+        r.add(b, Reactor::Handlers{[&b, &received] (void) {
+              uint32_t output;
+              b.read(&output, sizeof(uint32_t));
+              EXPECT_EQ(ntohl(output), b.get_input_address().port());
+              received++;
+            }});
+      }});
+  std::vector<std::unique_ptr<Bidirectional>> in;
+  for (uint32_t n = 0; n < n_connections; n++) {
+    in.emplace_back(std::make_unique<Bidirectional>(s.get_address()));
+    uint32_t network_format = htonl(in.back()->get_address().port());
+    in.back()->write(&network_format, sizeof(uint32_t));
+  }
+  while (received < n_connections)
+    ASSERT_NE(0, r.poll(1000));
+  EXPECT_EQ(n_connections + 1, r.size());
+  for (auto& a : accepted)
+    r.remove(*a);
+}
+
+TEST(Reactor, EdgeTriggered) {
+  Reactor r;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t sum = 0;
+  r.add(in, Reactor::Handlers{[&] (void) {
+        while (in.data_available()) {
+          uint32_t output;
+          in.read(&output, sizeof(uint32_t));
+          sum += ntohl(output);
+        }
+      }}, EPOLLIN, true);
+  for (uint32_t i = 1; i <= 4; i++) {
+    uint32_t network_format = htonl(i);
+    out->write(&network_format, sizeof(uint32_t));
+  }
+  while (sum < 10)
+    ASSERT_NE(0, r.poll(1000));
+  EXPECT_EQ(10, sum);
+  EXPECT_EQ(0, r.poll(10)); // drained, no new edge
+  r.remove(in);
+}
+
+TEST(Reactor, Hangup) {
+  Reactor r;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  std::unique_ptr<Connected> in(std::make_unique<Connected>(s.get_address()));
+  std::unique_ptr<Bidirectional> out = outF.get();
+  bool hangup = false;
+  r.add(*out, Reactor::Handlers{nullptr, nullptr, [&] (void) {
+        hangup = true;
+        r.remove(*out);
+      }});
+  in.reset();
+  while (!hangup)
+    ASSERT_NE(0, r.poll(1000));
+  EXPECT_EQ(0, r.size());
+}
+
+TEST(Reactor, Write) {
+  Reactor r;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  bool writable = false;
+  r.add(*out, Reactor::Handlers{nullptr, [&] (void) {
+        writable = true;
+        r.modify(*out, EPOLLIN);
+      }}, EPOLLIN | EPOLLOUT);
+  EXPECT_EQ(1, r.poll(1000));
+  EXPECT_TRUE(writable);
+  EXPECT_EQ(0, r.poll(10));
+  r.remove(*out);
+}
+
+// Edge-triggered descriptors are not reported again, so one throwing handler must not keep the
+// others in the batch from running.
+TEST(Reactor, HandlerThrows) {
+  Reactor r;
+  FileDescriptor first(eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC));
+  FileDescriptor second(eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC));
+  int called = 0;
+  auto handler = [&called] (void) {
+        called++;
+        throw std::runtime_error("handler failed");
+      };
+  r.add(first.get(), Reactor::Handlers{handler, nullptr, nullptr}, EPOLLIN, true);
+  r.add(second.get(), Reactor::Handlers{handler, nullptr, nullptr}, EPOLLIN, true);
+  EXPECT_THROW(r.poll(1000), std::runtime_error);
+  EXPECT_EQ(2, called);
+  EXPECT_EQ(0, r.poll(10)); // no new edge
+  r.remove(first.get());
+  r.remove(second.get());
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "socket/scheduler.hpp"
+
+#ifdef __cpp_impl_coroutine
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+static Scheduler::Task echo(Scheduler& scheduler, std::unique_ptr<Bidirectional> connection) {
+  try {
+    while (true) {
+      uint32_t value;
+      co_await connection->async_read(scheduler, &value, sizeof(uint32_t));
+      co_await connection->async_write(scheduler, &value, sizeof(uint32_t));
+    }
+  } catch (const std::system_error& e) {
+    EXPECT_EQ(ECONNRESET, e.code().value());
+  }
+}
+
+static Scheduler::Task serve(Scheduler& scheduler, Listening& listener, size_t n_connections) {
+  for (size_t n = 0; n < n_connections; n++)
+    scheduler.spawn(echo(scheduler, co_await listener.async_accept(scheduler)));
+}
+
+static Scheduler::Task client(Scheduler& scheduler, Address address, uint32_t n_messages,
+    uint32_t& finished) {
+  Bidirectional connection(address);
+  for (uint32_t i = 0; i < n_messages; i++) {
+    uint32_t input = htonl(i), output;
+    co_await connection.async_write(scheduler, &input, sizeof(uint32_t));
+    co_await connection.async_read(scheduler, &output, sizeof(uint32_t));
+    EXPECT_EQ(i, ntohl(output));
+  }
+  finished++;
+}
+
+// Coroutines take what they use as parameters, which live in the coroutine frame. A lambda's
+// captures would be read through a closure destroyed at the first suspension.
+static Scheduler::Task read_accepted(Scheduler& scheduler, Listening& listener, void* buf,
+    size_t count) {
+  std::unique_ptr<Bidirectional> connection(co_await listener.async_accept(scheduler));
+  co_await connection->async_read(scheduler, buf, count);
+}
+
+static Scheduler::Task write_all(Scheduler& scheduler, Bidirectional& connection, const void* buf,
+    size_t count) {
+  co_await connection.async_write(scheduler, buf, count);
+}
+
+static Scheduler::Task accept_guarded(Scheduler& scheduler, Listening& listener,
+    bool& destroyed) {
+  std::shared_ptr<void> guard(nullptr, [&destroyed] (void*) { destroyed = true; });
+  co_await listener.async_accept(scheduler);
+}
+
+TEST(Scheduler, ConstructDestruct) {
+  Scheduler s;
+  EXPECT_EQ(0, s.size());
+  EXPECT_EQ(0, s.run_once(10));
+}
+
+TEST(Scheduler, Echo) {
+  const uint32_t n_connections = 256;
+  const uint32_t n_messages = 64;
+  Scheduler s;
+  Listening l(PORT);
+  uint32_t finished = 0;
+  s.spawn(serve(s, l, n_connections));
+  for (uint32_t n = 0; n < n_connections; n++)
+    s.spawn(client(s, l.get_address(), n_messages, finished));
+  s.run();
+  EXPECT_EQ(n_connections, finished);
+  EXPECT_EQ(0, s.size());
+}
+
+TEST(Scheduler, LargeWrite) {
+  const size_t size = 8 << 20; // larger than the socket buffers, so both sides suspend
+  Scheduler s;
+  Listening l(PORT);
+  std::vector<char> input(size), output(size);
+  for (size_t i = 0; i < size; i++)
+    input[i] = i % 251;
+  s.spawn(read_accepted(s, l, output.data(), size));
+  Bidirectional out(l.get_address());
+  s.spawn(write_all(s, out, input.data(), size));
+  s.run();
+  EXPECT_EQ(input, output);
+#ifdef SOCKET_STATS
+  EXPECT_EQ(size, out.get_counters().bytes_written);
+  EXPECT_LT(0, out.get_counters().would_block);
+#endif
+}
+
+TEST(Scheduler, Exception) {
+  Scheduler s;
+  Listening l(PORT);
+  uint32_t value;
+  s.spawn(read_accepted(s, l, &value, sizeof(uint32_t))); // throws, the peer closes
+  Connected(l.get_address());
+  EXPECT_THROW(s.run(), std::system_error);
+  EXPECT_EQ(0, s.size());
+}
+
+TEST(Scheduler, DestroySuspended) {
+  Listening l(PORT);
+  bool destroyed = false;
+  {
+    Scheduler s;
+    s.spawn(accept_guarded(s, l, destroyed));
+    EXPECT_EQ(1, s.size());
+    EXPECT_EQ(0, s.run_once(10));
+  }
+  EXPECT_TRUE(destroyed);
+}
+
+} // namespace socket
+} // namespace wrapper
+#endif
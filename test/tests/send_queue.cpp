@@ -0,0 +1,86 @@
+#include <future>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "socket/buffered_connection.hpp"
+#include "socket/send_queue.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(SendQueue, PushFlush) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  SendQueue q(*out);
+  EXPECT_TRUE(q.empty());
+  for (uint32_t i = 0; i < 4; i++)
+    q.push(&i, sizeof(uint32_t));
+  EXPECT_FALSE(q.empty());
+  usleep(1000);
+  EXPECT_FALSE(in.data_available());
+  EXPECT_TRUE(q.flush());
+  EXPECT_TRUE(q.empty());
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t output;
+    in.read(&output, sizeof(uint32_t));
+    EXPECT_EQ(i, output);
+  }
+}
+
+TEST(SendQueue, Destroy) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  {
+    SendQueue q(*out);
+    q.push("abc", 3);
+  }
+  char output[3];
+  EXPECT_TRUE(in.read(output, 3, 1000));
+  EXPECT_EQ(std::string("abc"), std::string(output, 3));
+}
+
+TEST(SendQueue, ManyWriters) {
+  const uint32_t n_threads = 4;
+  const uint32_t n_messages = 10000;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  SendQueue q(*out);
+  std::vector<std::thread> writers;
+  for (uint32_t t = 0; t < n_threads; t++)
+    writers.emplace_back([&q, t, n_messages] (void) {
+          for (uint32_t i = 0; i < n_messages; i++) {
+            uint32_t message[2] = {t, i};
+            q.send(message, sizeof(message));
+          }
+        });
+  BufferedConnection b(in);
+  std::vector<uint32_t> next(n_threads, 0);
+  uint32_t message[2];
+  uint32_t n = 0;
+  // Failures only break out of the loop: returning would leave the writers joinable.
+  for (; n < n_threads * n_messages; n++) {
+    if (!b.read_exact(message, sizeof(message), 5000))
+      break;
+    EXPECT_LT(message[0], n_threads);
+    if (message[0] >= n_threads)
+      break;
+    EXPECT_EQ(next[message[0]]++, message[1]); // each writer's messages stay in order
+  }
+  if (n < n_threads * n_messages) // let writers blocked on a full socket finish
+    while (b.read_exact(message, sizeof(message), 100)) {}
+  for (auto& w : writers)
+    w.join();
+  EXPECT_EQ(n_threads * n_messages, n);
+  EXPECT_TRUE(q.empty());
+}
+
+} // namespace socket
+} // namespace wrapper
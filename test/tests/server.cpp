@@ -0,0 +1,157 @@
+#include <sys/resource.h>
+
+#include "gtest/gtest.h"
+#include "socket/server.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+// Answers every complete line with the same line.
+static size_t echo_lines(const char* data, size_t size, std::string& response) {
+  const char* end = static_cast<const char*>(std::memchr(data, '\n', size));
+  if (!end)
+    return 0;
+  response.append(data, end + 1 - data);
+  return end + 1 - data;
+}
+
+static ServerConfig get_config(size_t workers) {
+  ServerConfig config;
+  config.workers = workers;
+  config.pool_threads = 2;
+  return config;
+}
+
+static std::string read_line(Connected& connection) {
+  std::string line;
+  char c = 0;
+  while (c != '\n' && connection.read(&c, 1, 1000))
+    line += c;
+  return line;
+}
+
+TEST(Server, Echo) {
+  Server server(Address("127.0.0.1", PORT), echo_lines, get_config(2));
+  EXPECT_EQ(2, server.get_workers());
+  std::vector<std::unique_ptr<Bidirectional>> clients;
+  for (int i = 0; i < 8; i++)
+    clients.push_back(std::make_unique<Bidirectional>(server.get_address()));
+  for (int round = 0; round < 10; round++) {
+    for (size_t i = 0; i < clients.size(); i++) {
+      std::string line = std::to_string(i) + " " + std::to_string(round) + "\n";
+      clients[i]->write(line.data(), line.size());
+    }
+    for (size_t i = 0; i < clients.size(); i++)
+      EXPECT_EQ(std::to_string(i) + " " + std::to_string(round) + "\n", read_line(*clients[i]));
+  }
+  EXPECT_EQ(8, server.accepted());
+  EXPECT_EQ(8, server.connections());
+  clients.clear();
+  for (int i = 0; i < 100 && server.connections() > 0; i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(0, server.connections());
+}
+
+// A request split across writes waits for the rest, and pipelined requests are answered in order.
+TEST(Server, Framing) {
+  Server server(Address("127.0.0.1", PORT), echo_lines, get_config(1));
+  Bidirectional client(server.get_address());
+  client.write("spl", 3);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  client.write("it\nfirst\nsecond\n", 16);
+  EXPECT_EQ("split\n", read_line(client));
+  EXPECT_EQ("first\n", read_line(client));
+  EXPECT_EQ("second\n", read_line(client));
+}
+
+TEST(Server, HandlerThrows) {
+  Server server(Address("127.0.0.1", PORT), [] (const char*, size_t, std::string&) -> size_t {
+        throw std::runtime_error("bad request");
+      }, get_config(1));
+  Bidirectional client(server.get_address());
+  client.write("x\n", 2);
+  char c;
+  EXPECT_THROW(client.read(&c, 1, 1000), std::system_error);
+}
+
+// A slow request on one connection does not hold up the others, even on the same worker.
+TEST(Server, SlowRequest) {
+  Server server(Address("127.0.0.1", PORT), [] (const char* data, size_t size,
+        std::string& response) {
+        if (data[0] == 's')
+          std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        return echo_lines(data, size, response);
+      }, get_config(1));
+  Bidirectional slow(server.get_address());
+  Bidirectional fast(server.get_address());
+  slow.write("slow\n", 5);
+  auto start = std::chrono::steady_clock::now();
+  fast.write("fast\n", 5);
+  EXPECT_EQ("fast\n", read_line(fast));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(400));
+  EXPECT_EQ("slow\n", read_line(slow));
+}
+
+// A client that shuts down its side after the request still gets the whole response, though the
+// socket buffers cannot hold it.
+TEST(Server, HalfClose) {
+  const size_t size = 8 << 20;
+  Server server(Address("127.0.0.1", PORT), [size] (const char* data, size_t count,
+        std::string& response) {
+        response.assign(size, 'x');
+        return count;
+      }, get_config(1));
+  Address address = server.get_address();
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ(0, ::connect(fd, address.get_sockaddr(), address.get_sockaddr_size()));
+  ASSERT_EQ(4, ::send(fd, "big\n", 4, MSG_NOSIGNAL));
+  ASSERT_EQ(0, ::shutdown(fd, SHUT_WR));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the server see the end first
+  std::vector<char> buffer(65536);
+  size_t received = 0;
+  ssize_t ret;
+  while ((ret = ::recv(fd, buffer.data(), buffer.size(), 0)) > 0)
+    received += ret;
+  EXPECT_EQ(0, ret); // closed, not reset
+  EXPECT_EQ(size, received);
+  ::close(fd);
+  for (int i = 0; i < 100 && server.connections() > 0; i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(0, server.connections());
+}
+
+static std::chrono::microseconds cpu_time(void) {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+      std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+// Out of descriptors, the waiting connection is left in the backlog without spinning on it.
+TEST(Server, OutOfDescriptors) {
+  Server server(Address("127.0.0.1", PORT), echo_lines, get_config(1));
+  rlimit limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+  int next_fd = dup(0);
+  ::close(next_fd);
+  rlimit lowered = limit;
+  // Lowered before connecting, so the acceptor cannot take the connection first. There is room
+  // for the client's socket but not for the accepted one.
+  lowered.rlim_cur = next_fd + 1;
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &lowered));
+  Bidirectional client(server.get_address());
+  std::chrono::microseconds start = cpu_time();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_LT(cpu_time() - start, std::chrono::milliseconds(100));
+  EXPECT_EQ(0, server.accepted());
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &limit));
+  client.write("x\n", 2);
+  EXPECT_EQ("x\n", read_line(client));
+  EXPECT_EQ(1, server.accepted());
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -1,4 +1,6 @@
 #include <future>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
 
 #include "gtest/gtest.h"
 #include "socket/socket.hpp"
@@ -123,6 +125,71 @@ TEST(Socket, DetectIP) {
   EXPECT_NE("", my_ip);
 }
 
+TEST(Socket, BindAddress) {
+  Listening s(Address(IP, PORT));
+  EXPECT_EQ(Address(IP, PORT), s.get_address());
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  EXPECT_EQ(Address(IP, PORT), out->get_address());
+  EXPECT_EQ(in.get_address(), out->get_input_address());
+}
+
+TEST(Socket, BindEphemeralPort) {
+  Listening s(Address(IP, 0));
+  EXPECT_NE(0, s.get_address().port());
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  outF.get();
+}
+
+TEST(Socket, BindV6) {
+  std::unique_ptr<Listening> s;
+  try {
+    s = std::make_unique<Listening>(Address("::1", PORT));
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "IPv6 loopback is not available: " << e.what();
+  }
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, s.get(), -1);
+  Bidirectional in(s->get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  EXPECT_EQ(AF_INET6, out->get_input_address().family());
+  EXPECT_EQ(in.get_address(), out->get_input_address());
+  uint32_t input = 42, output;
+  in.write(&input, sizeof(uint32_t));
+  out->read(&output, sizeof(uint32_t));
+  EXPECT_EQ(input, output);
+}
+
+TEST(Socket, ConnectMany) {
+  const size_t n_connections = 64;
+  Listening s(PORT);
+  std::vector<Address> addresses(n_connections, s.get_address());
+  addresses.push_back(Address(IP, PORT + 1)); // nothing listens there
+  std::vector<ConnectResult> results(connect_many(addresses, 1000));
+  ASSERT_EQ(n_connections + 1, results.size());
+  std::vector<std::unique_ptr<Bidirectional>> accepted;
+  while (accepted.size() < n_connections)
+    for (auto& b : s.accept_batch(n_connections, 1000))
+      accepted.push_back(std::move(b));
+  for (size_t n = 0; n < n_connections; n++) {
+    ASSERT_EQ(0, results[n].error);
+    ASSERT_NE(nullptr, results[n].connection);
+    EXPECT_EQ(s.get_address(), results[n].connection->get_listening_address());
+    uint32_t input = htonl(n), output;
+    results[n].connection->write(&input, sizeof(uint32_t));
+    auto out = std::find_if(accepted.begin(), accepted.end(), [&] (auto& a) {
+          return a->get_input_address() == results[n].connection->get_address();
+        });
+    ASSERT_NE(accepted.end(), out);
+    (*out)->read(&output, sizeof(uint32_t));
+    EXPECT_EQ(n, ntohl(output));
+  }
+  EXPECT_EQ(ECONNREFUSED, results.back().error);
+  EXPECT_EQ(nullptr, results.back().connection);
+  EXPECT_TRUE(connect_many({}).empty());
+}
+
 TEST(Socket, DataNotAvailable) {
   Listening s(PORT);
   std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
@@ -212,6 +279,52 @@ TEST(Socket, PartialTimeout) {
   EXPECT_FALSE(in.read(&output, sizeof(uint32_t), 10));
 }
 
+TEST(Socket, TimeoutThenBlock) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t output;
+  EXPECT_FALSE(in.read(&output, sizeof(uint32_t), 10));
+  std::future<bool> readF = std::async(std::launch::async, [&in, &output] (void) -> bool {
+        return in.read(&output, sizeof(uint32_t));
+      });
+  usleep(20000); // longer than the previous timeout
+  uint32_t network_format = htonl(123);
+  out->write(&network_format, sizeof(uint32_t));
+  EXPECT_TRUE(readF.get());
+  EXPECT_EQ(123, ntohl(output));
+}
+
+TEST(Socket, TimeoutDeadline) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> writeF = std::async(std::launch::async, [&out] (void) {
+        char d = 'a';
+        for (int i = 0; i < 3; i++) {
+          usleep(20000);
+          out->write(&d, sizeof(char));
+        }
+      });
+  // The timeout covers the whole read, not each partial receive.
+  uint32_t output;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(in.read(&output, sizeof(uint32_t), 50));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+  writeF.get();
+}
+
+TEST(Socket, ReadClosed) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  outF.get(); // accepted socket is closed
+  uint32_t output;
+  EXPECT_THROW(in.read(&output, sizeof(uint32_t)), std::system_error);
+}
+
 TEST(Socket, ConnectedAddress) {
   Listening s(PORT);
   EXPECT_EQ(Address(get_my_ip(), PORT), s.get_address());
@@ -246,6 +359,236 @@ TEST(Socket, TwoSocketDifferentAddress) {
   EXPECT_EQ(a1.get_listening_address(), b2->get_listening_address());
 }
 
+TEST(Socket, AcceptBatch) {
+  const uint32_t n_connections = 16;
+  Listening s(PORT);
+  std::vector<std::unique_ptr<Bidirectional>> in;
+  for (uint32_t n = 0; n < n_connections; n++)
+    in.emplace_back(std::make_unique<Bidirectional>(s.get_address()));
+  std::vector<std::unique_ptr<Bidirectional>> out;
+  while (out.size() < n_connections) {
+    std::vector<std::unique_ptr<Bidirectional>> batch = s.accept_batch(n_connections, 1000);
+    ASSERT_FALSE(batch.empty());
+    for (auto& b : batch)
+      out.push_back(std::move(b));
+  }
+  for (uint32_t n = 0; n < n_connections; n++) {
+    EXPECT_EQ(in[n]->get_address(), out[n]->get_input_address());
+    EXPECT_EQ(in[n]->get_input_address(), out[n]->get_address());
+  }
+  EXPECT_TRUE(s.accept_batch(n_connections, 0).empty());
+}
+
+TEST(Socket, AcceptBatchMax) {
+  Listening s(PORT);
+  Connected in1(s.get_address());
+  Connected in2(s.get_address());
+  usleep(1000); // let both connections reach the backlog
+  EXPECT_EQ(1, s.accept_batch(1, 1000).size());
+  EXPECT_EQ(1, s.accept_batch(1, 1000).size());
+  EXPECT_TRUE(s.accept_batch(1, 10).empty());
+}
+
+TEST(Socket, AcceptBatchError) {
+  Listening s(PORT);
+  Connected in1(s.get_address());
+  Connected in2(s.get_address());
+  usleep(1000); // let both connections reach the backlog
+  rlimit limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+  int next_fd = dup(0);
+  ::close(next_fd);
+  rlimit lowered = limit;
+  lowered.rlim_cur = next_fd + 1; // room for one accepted socket
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &lowered));
+  std::vector<std::unique_ptr<Bidirectional>> first;
+  EXPECT_NO_THROW(first = s.accept_batch(2, 1000));
+  EXPECT_EQ(1, first.size()); // kept, the EMFILE is left for the next call
+  EXPECT_THROW(s.accept_batch(2, 1000), std::system_error);
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &limit));
+  EXPECT_EQ(1, s.accept_batch(2, 1000).size());
+}
+
+TEST(Socket, AcceptBatchNonBlocking) {
+  Listening s(PORT);
+  Bidirectional in(s.get_address());
+  std::vector<std::unique_ptr<Bidirectional>> out = s.accept_batch(1);
+  ASSERT_EQ(1, out.size());
+  uint32_t output;
+  EXPECT_FALSE(out[0]->read(&output, sizeof(uint32_t), 10));
+  std::future<bool> readF = std::async(std::launch::async, [&out, &output] (void) -> bool {
+        return out[0]->read(&output, sizeof(uint32_t));
+      });
+  usleep(100); // let read start waiting
+  uint32_t network_format = htonl(123);
+  in.write(&network_format, sizeof(uint32_t));
+  EXPECT_TRUE(readF.get());
+  EXPECT_EQ(123, ntohl(output));
+  std::vector<char> large(1 << 22, 'a');
+  std::future<void> writeF = std::async(std::launch::async, [&out, &large] (void) {
+        out[0]->write(large.data(), large.size());
+      });
+  std::vector<char> received(large.size());
+  in.read(received.data(), received.size());
+  writeF.get();
+  EXPECT_EQ(large, received);
+}
+
+TEST(Socket, TryRead) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  std::unique_ptr<Bidirectional> in(std::make_unique<Bidirectional>(s.get_address()));
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t output;
+  EXPECT_EQ(0, out->try_read(&output, sizeof(uint32_t))); // a blocking socket does not wait
+  uint32_t network_format = htonl(123);
+  in->write(&network_format, sizeof(uint32_t));
+  while (!out->data_available())
+    usleep(100);
+  EXPECT_EQ(sizeof(uint32_t), out->try_read(&output, sizeof(uint32_t)));
+  EXPECT_EQ(123, ntohl(output));
+  in.reset();
+  while (!out->data_available())
+    usleep(100);
+  EXPECT_THROW(out->try_read(&output, sizeof(uint32_t)), std::system_error);
+}
+
+TEST(Socket, Writev) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t header = htonl(5);
+  char payload[] = "hello";
+  iovec iov[3] = {{&header, sizeof(uint32_t)}, {nullptr, 0}, {payload, 5}};
+  out->writev(iov, 3);
+  uint32_t output;
+  in.read(&output, sizeof(uint32_t));
+  EXPECT_EQ(5, ntohl(output));
+  char received[5];
+  in.read(received, 5);
+  EXPECT_EQ("hello", std::string(received, 5));
+}
+
+TEST(Socket, WritevPartial) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  // More buffers than IOV_MAX and more bytes than the socket buffer hold.
+  const size_t n_buffers = 2 * IOV_MAX;
+  std::vector<std::vector<char>> buffers;
+  std::vector<iovec> iov;
+  for (size_t i = 0; i < n_buffers; i++) {
+    buffers.emplace_back(i % 7 * 1000, static_cast<char>(i));
+    iov.push_back({buffers.back().data(), buffers.back().size()});
+  }
+  std::future<void> writeF = std::async(std::launch::async, [&out, &iov] (void) {
+        out->writev(iov.data(), iov.size());
+      });
+  for (const auto& b : buffers) {
+    std::vector<char> received(b.size());
+    in.read(received.data(), received.size());
+    EXPECT_EQ(b, received);
+  }
+  writeF.get();
+}
+
+TEST(Socket, SendFile) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  char path[] = "/tmp/socket-send-file-XXXXXX";
+  FileDescriptor file(mkstemp(path));
+  ASSERT_NE(-1, file.get());
+  unlink(path);
+  std::vector<char> contents(1 << 20);
+  for (size_t i = 0; i < contents.size(); i++)
+    contents[i] = i;
+  ASSERT_EQ(contents.size(), ::write(file.get(), contents.data(), contents.size()));
+  const size_t offset = 1000;
+  std::future<void> sendF = std::async(std::launch::async, [&out, &file, &contents] (void) {
+        out->send_file(file.get(), offset, contents.size() - offset);
+      });
+  std::vector<char> received(contents.size() - offset);
+  in.read(received.data(), received.size());
+  sendF.get();
+  EXPECT_TRUE(std::equal(received.begin(), received.end(), contents.begin() + offset));
+  EXPECT_THROW(out->send_file(file.get(), 0, contents.size() + 1), std::runtime_error);
+}
+
+TEST(Socket, SendFilePipe) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  FileDescriptor read_end(fds[0]);
+  FileDescriptor write_end(fds[1]);
+  std::string contents("piped through the socket");
+  ASSERT_EQ(contents.size(), ::write(write_end.get(), contents.data(), contents.size()));
+  out->send_file(read_end.get(), 0, contents.size());
+  std::vector<char> received(contents.size());
+  in.read(received.data(), received.size());
+  EXPECT_EQ(contents, std::string(received.begin(), received.end()));
+}
+
+TEST(Socket, Zerocopy) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  if (!out->enable_zerocopy())
+    std::cout << "SO_ZEROCOPY unsupported, testing the copy fallback" << std::endl;
+  std::vector<char> buf(1 << 16, 'z');
+  std::vector<uint64_t> tickets;
+  for (int i = 0; i < 4; i++)
+    tickets.push_back(out->send_zerocopy(buf.data(), buf.size()));
+  std::vector<char> received(buf.size());
+  for (int i = 0; i < 4; i++) {
+    in.read(received.data(), received.size());
+    EXPECT_EQ(buf, received);
+  }
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (out->zerocopy_completed(100) < tickets.back() &&
+      std::chrono::steady_clock::now() < deadline);
+  EXPECT_GE(out->zerocopy_completed(), tickets.back());
+}
+
+TEST(Socket, ZerocopyOutOfOrder) {
+  ZerocopyCompletions z;
+  for (int i = 0; i < 4; i++)
+    z.send();
+  z.complete(2, 2); // sends 0 and 1 are still pinned
+  EXPECT_EQ(0, z.get_completed());
+  z.complete(0, 0);
+  EXPECT_EQ(1, z.get_completed());
+  z.complete(1, 1); // fills the gap up to the range already seen
+  EXPECT_EQ(3, z.get_completed());
+  z.complete(1, 2); // counted already
+  EXPECT_EQ(3, z.get_completed());
+  z.complete(3, 3);
+  EXPECT_EQ(4, z.get_completed());
+  z.complete(4, 4); // never sent
+  EXPECT_EQ(4, z.get_completed());
+}
+
+TEST(Socket, ZerocopyDisabled) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t network_format = htonl(123);
+  uint64_t ticket = out->send_zerocopy(&network_format, sizeof(uint32_t));
+  EXPECT_GE(out->zerocopy_completed(), ticket); // copied, so immediately reusable
+  uint32_t output;
+  in.read(&output, sizeof(uint32_t));
+  EXPECT_EQ(123, ntohl(output));
+}
+
 TEST(Socket, Bidirectional) {
   const int count = 123;
   Listening s(PORT);
@@ -271,5 +614,30 @@ TEST(Socket, Bidirectional) {
     }
   }
 }
+
+TEST(Socket, Options) {
+  SocketOptions options;
+  options.no_delay = true;
+  options.receive_buffer = 1 << 16;
+  options.backlog = 16;
+  Listening s(PORT, options);
+  EXPECT_EQ(1, s.get_option(IPPROTO_TCP, TCP_NODELAY));
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address(), options);
+  std::unique_ptr<Bidirectional> out = outF.get();
+  EXPECT_EQ(1, in.get_option(IPPROTO_TCP, TCP_NODELAY));
+  EXPECT_EQ(1, out->get_option(IPPROTO_TCP, TCP_NODELAY)); // inherited from the listener
+  EXPECT_EQ(2 << 16, out->get_option(SOL_SOCKET, SO_RCVBUF)); // doubled by the kernel
+  EXPECT_EQ(1, s.get_option(SOL_SOCKET, SO_REUSEADDR));
+  EXPECT_EQ(0, s.get_option(SOL_SOCKET, SO_REUSEPORT));
+}
+
+TEST(Socket, OptionsDefault) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  EXPECT_EQ(0, in.get_option(IPPROTO_TCP, TCP_NODELAY));
+  EXPECT_EQ(0, outF.get()->get_option(IPPROTO_TCP, TCP_NODELAY));
+}
 } // namespace socket
 } // namespace wrapper
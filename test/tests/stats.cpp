@@ -0,0 +1,139 @@
+#include <future>
+#include <netinet/tcp.h>
+
+#include "gtest/gtest.h"
+#include "socket/socket.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(Stats, Histogram) {
+  LatencyHistogram h;
+  EXPECT_EQ(0, h.percentile(0.5));
+  h.buckets[10] = 90; // [1024, 2048) ns
+  h.buckets[20] = 10;
+  EXPECT_EQ(100, h.count());
+  EXPECT_EQ(2048, h.percentile(0.5));
+  EXPECT_EQ(2048, h.percentile(0.9));
+  EXPECT_EQ(2 << 20, h.percentile(0.99));
+}
+
+TEST(Stats, Counters) {
+  StatsSnapshot before = get_stats();
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t message = 0;
+  for (int i = 0; i < 10; i++) {
+    in.write(&message, sizeof(uint32_t));
+    out->read(&message, sizeof(uint32_t));
+  }
+  EXPECT_FALSE(out->read(&message, sizeof(uint32_t), 0));
+  SocketCounters sent = in.get_counters(), received = out->get_counters();
+  StatsSnapshot after = get_stats();
+#ifdef SOCKET_STATS
+  EXPECT_EQ(10 * sizeof(uint32_t), sent.bytes_written);
+  EXPECT_EQ(10, sent.write_calls);
+  EXPECT_EQ(0, sent.partial_writes);
+  EXPECT_EQ(10 * sizeof(uint32_t), received.bytes_read);
+  EXPECT_EQ(10, received.read_calls);
+  EXPECT_EQ(1, received.would_block);
+  EXPECT_EQ(1, received.timeouts);
+  EXPECT_EQ(1, s.get_counters().accepts);
+  // The accept ran on another thread, which has exited, and is still counted.
+  EXPECT_EQ(before.counters.accepts + 1, after.counters.accepts);
+  EXPECT_EQ(before.counters.bytes_written + 10 * sizeof(uint32_t), after.counters.bytes_written);
+  EXPECT_EQ(before.latency[STATS_WRITE].count() + 10, after.latency[STATS_WRITE].count());
+  EXPECT_EQ(before.latency[STATS_READ].count() + 11, after.latency[STATS_READ].count());
+  EXPECT_LT(0, after.latency[STATS_READ].percentile(0.5));
+#else
+  EXPECT_EQ(0, sent.bytes_written);
+  EXPECT_EQ(0, received.bytes_read);
+  EXPECT_EQ(0, before.counters.bytes_written);
+  EXPECT_EQ(0, after.counters.bytes_written);
+  EXPECT_EQ(0, after.latency[STATS_READ].count());
+#endif
+}
+
+TEST(Stats, SendPaths) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  char path[] = "/tmp/socket-stats-XXXXXX";
+  FileDescriptor file(mkstemp(path));
+  ASSERT_NE(-1, file.get());
+  unlink(path);
+  std::vector<char> contents(4096, 'f');
+  ASSERT_EQ(contents.size(), ::write(file.get(), contents.data(), contents.size()));
+  out->send_file(file.get(), 0, contents.size());
+  out->enable_zerocopy(); // counted the same whether or not the kernel supports it
+  std::vector<char> message(4096, 'z');
+  out->send_zerocopy(message.data(), message.size());
+  std::vector<char> received(contents.size() + message.size());
+  in.read(received.data(), received.size());
+  SocketCounters sent = out->get_counters();
+#ifdef SOCKET_STATS
+  EXPECT_EQ(contents.size() + message.size(), sent.bytes_written);
+  EXPECT_LE(2, sent.write_calls);
+#else
+  EXPECT_EQ(0, sent.bytes_written);
+#endif
+}
+
+TEST(Stats, FullDuplex) {
+  const uint32_t n_messages = 100000;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  // One thread reads from out while another writes to it.
+  std::future<void> writeF = std::async(std::launch::async, [&out] (void) {
+        uint32_t message = 0;
+        for (uint32_t i = 0; i < n_messages; i++)
+          out->write(&message, sizeof(uint32_t));
+      });
+  std::future<void> readF = std::async(std::launch::async, [&out] (void) {
+        uint32_t message;
+        for (uint32_t i = 0; i < n_messages; i++)
+          out->read(&message, sizeof(uint32_t));
+      });
+  std::future<void> echoF = std::async(std::launch::async, [&in] (void) {
+        uint32_t message = 0;
+        for (uint32_t i = 0; i < n_messages; i++)
+          in.write(&message, sizeof(uint32_t));
+        std::vector<char> received(n_messages * sizeof(uint32_t));
+        in.read(received.data(), received.size());
+      });
+  writeF.get();
+  readF.get();
+  echoF.get();
+  SocketCounters counters = out->get_counters();
+#ifdef SOCKET_STATS
+  EXPECT_EQ(n_messages * sizeof(uint32_t), counters.bytes_written);
+  EXPECT_EQ(n_messages * sizeof(uint32_t), counters.bytes_read);
+  EXPECT_EQ(n_messages, counters.write_calls);
+#else
+  EXPECT_EQ(0, counters.bytes_written);
+#endif
+}
+
+TEST(Stats, TcpInfo) {
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  uint32_t message = 0;
+  in.write(&message, sizeof(uint32_t));
+  out->read(&message, sizeof(uint32_t));
+  TcpInfo info = in.get_tcp_info();
+  EXPECT_EQ(TCP_ESTABLISHED, info.state);
+  EXPECT_LT(0, info.cwnd);
+  EXPECT_EQ(0, info.total_retransmits);
+}
+
+} // namespace socket
+} // namespace wrapper
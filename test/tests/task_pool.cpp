@@ -0,0 +1,79 @@
+#include <future>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "socket/task_pool.hpp"
+
+namespace wrapper {
+namespace socket {
+
+TEST(TaskPool, Submit) {
+  std::atomic<int> done(0);
+  {
+    TaskPool pool(4);
+    EXPECT_EQ(4, pool.size());
+    for (int i = 0; i < 1000; i++)
+      pool.submit([&done] (void) { done++; });
+  } // runs what is still queued
+  EXPECT_EQ(1000, done);
+}
+
+// Outside submissions start in the order they were made, also behind a busy thread.
+TEST(TaskPool, OutsideFifo) {
+  const int n_tasks = 16;
+  std::vector<int> order;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  {
+    TaskPool pool(1);
+    pool.submit([released] (void) { released.wait(); });
+    for (int i = 0; i < n_tasks; i++)
+      pool.submit([&order, i] (void) { order.push_back(i); });
+    release.set_value();
+  }
+  ASSERT_EQ(n_tasks, order.size());
+  for (int i = 0; i < n_tasks; i++)
+    EXPECT_EQ(i, order[i]);
+}
+
+// A task queues work on its own thread's deque and then blocks until that work is done, which
+// can only happen if the other threads steal it.
+TEST(TaskPool, Steal) {
+  const int n_tasks = 64;
+  TaskPool pool(4);
+  std::mutex mutex;
+  std::set<std::thread::id> ran_on;
+  std::atomic<int> done(0);
+  std::promise<std::thread::id> blocked;
+  pool.submit([&] (void) {
+        for (int i = 0; i < n_tasks; i++)
+          pool.submit([&] (void) {
+                {
+                  std::lock_guard<std::mutex> lock(mutex);
+                  ran_on.insert(std::this_thread::get_id());
+                }
+                done++;
+              });
+        while (done < n_tasks)
+          std::this_thread::yield();
+        blocked.set_value(std::this_thread::get_id());
+      });
+  std::thread::id owner = blocked.get_future().get();
+  EXPECT_EQ(n_tasks, done);
+  EXPECT_EQ(0, ran_on.count(owner));
+}
+
+TEST(TaskPool, Nested) {
+  std::atomic<int> done(0);
+  {
+    TaskPool pool(2);
+    pool.submit([&] (void) {
+          for (int i = 0; i < 10; i++)
+            pool.submit([&done] (void) { done++; });
+        });
+  }
+  EXPECT_EQ(10, done);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,157 @@
+#include <future>
+
+#include "gtest/gtest.h"
+#include "socket/timer_wheel.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+using std::chrono::milliseconds;
+
+// Polls until the condition holds or a second has passed.
+template <typename F>
+static bool poll_until(Reactor& r, F condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (!condition() && std::chrono::steady_clock::now() < deadline)
+    r.poll(10);
+  return condition();
+}
+
+TEST(TimerWheel, Fire) {
+  Reactor r;
+  TimerWheel w(r, milliseconds(1), 64);
+  int fired = 0;
+  TimerWheel::Timer t([&fired] (void) { fired++; });
+  auto start = std::chrono::steady_clock::now();
+  w.arm(t, milliseconds(5));
+  EXPECT_TRUE(t.armed());
+  EXPECT_EQ(1, w.size());
+  EXPECT_TRUE(poll_until(r, [&fired] (void) { return fired > 0; }));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds(4));
+  EXPECT_EQ(1, fired);
+  EXPECT_FALSE(t.armed());
+  EXPECT_EQ(0, w.size());
+}
+
+// The wheel is already ticking, with an expiration not read yet, so the next tick is due as soon
+// as the timer is armed.
+TEST(TimerWheel, FireWhileRunning) {
+  Reactor r;
+  TimerWheel w(r, milliseconds(10), 64);
+  TimerWheel::Timer running([] (void) {});
+  w.arm(running, milliseconds(1000));
+  usleep(15000);
+  bool fired = false;
+  TimerWheel::Timer t([&fired] (void) { fired = true; });
+  auto start = std::chrono::steady_clock::now();
+  w.arm(t, milliseconds(10));
+  EXPECT_TRUE(poll_until(r, [&fired] (void) { return fired; }));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds(10));
+  EXPECT_TRUE(running.armed());
+}
+
+TEST(TimerWheel, Rounds) {
+  Reactor r;
+  TimerWheel w(r, milliseconds(1), 4); // the delay spans several turns
+  bool fired = false;
+  TimerWheel::Timer t([&fired] (void) { fired = true; });
+  auto start = std::chrono::steady_clock::now();
+  w.arm(t, milliseconds(30));
+  EXPECT_TRUE(poll_until(r, [&fired] (void) { return fired; }));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds(29));
+}
+
+TEST(TimerWheel, ResetCancel) {
+  Reactor r;
+  TimerWheel w(r, milliseconds(1), 64);
+  bool fired = false;
+  TimerWheel::Timer t([&fired] (void) { fired = true; });
+  for (int i = 0; i < 10; i++) { // kept alive by activity
+    w.arm(t, milliseconds(20));
+    r.poll(5);
+  }
+  EXPECT_FALSE(fired);
+  w.cancel(t);
+  EXPECT_FALSE(t.armed());
+  EXPECT_EQ(0, w.size());
+  r.poll(30);
+  r.poll(30);
+  EXPECT_FALSE(fired);
+  {
+    TimerWheel::Timer destroyed([&fired] (void) { fired = true; });
+    w.arm(destroyed, milliseconds(1));
+  }
+  EXPECT_EQ(0, w.size());
+  r.poll(30);
+  EXPECT_FALSE(fired);
+}
+
+TEST(TimerWheel, IdleDoesNotTick) {
+  Reactor r;
+  TimerWheel w(r, milliseconds(1), 64);
+  EXPECT_EQ(0, r.poll(20));
+  bool fired = false;
+  TimerWheel::Timer t([&fired] (void) { fired = true; });
+  w.arm(t, milliseconds(50));
+  EXPECT_EQ(1, r.poll(20)); // ticking while armed
+  w.cancel(t);
+  EXPECT_EQ(0, r.poll(20));
+  w.arm(t, milliseconds(2));
+  EXPECT_TRUE(poll_until(r, [&fired] (void) { return fired; }));
+  EXPECT_EQ(0, r.poll(20));
+}
+
+TEST(TimerWheel, Many) {
+  const size_t n_timers = 10000;
+  Reactor r;
+  TimerWheel w(r, milliseconds(1), 16);
+  size_t fired = 0;
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  for (size_t i = 0; i < n_timers; i++) {
+    timers.push_back(std::make_unique<TimerWheel::Timer>([&fired] (void) { fired++; }));
+    w.arm(*timers.back(), milliseconds(i % 50));
+  }
+  EXPECT_EQ(n_timers, w.size());
+  EXPECT_TRUE(poll_until(r, [&fired, n_timers] (void) { return fired >= n_timers; }));
+  r.poll(10);
+  EXPECT_EQ(n_timers, fired);
+}
+
+// The usual use: each connection has an idle deadline pushed back by every read, and the
+// callback closes the connection, destroying its own timer.
+TEST(TimerWheel, IdleConnection) {
+  struct Connection {
+    std::unique_ptr<Bidirectional> socket;
+    TimerWheel::Timer idle;
+  };
+  Reactor r;
+  TimerWheel w(r, milliseconds(1), 64);
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Connection> c;
+  c.reset(new Connection{outF.get(), TimerWheel::Timer([&r, &c] (void) {
+        r.remove(*c->socket);
+        c.reset();
+      })});
+  r.add(*c->socket, Reactor::Handlers{[&w, &c] (void) {
+        uint32_t message;
+        c->socket->read(&message, sizeof(uint32_t));
+        w.arm(c->idle, milliseconds(20));
+      }, nullptr, nullptr});
+  w.arm(c->idle, milliseconds(20));
+  for (uint32_t i = 0; i < 5; i++) {
+    in.write(&i, sizeof(uint32_t));
+    r.poll(5);
+    r.poll(5);
+  }
+  EXPECT_TRUE(c);
+  EXPECT_TRUE(poll_until(r, [&c] (void) { return !c; }));
+  uint32_t message;
+  EXPECT_THROW(in.read(&message, sizeof(uint32_t), 1000), std::system_error);
+}
+
+} // namespace socket
+} // namespace wrapper
@@ -0,0 +1,73 @@
+#include "socket/tls.hpp"
+
+#ifdef SOCKET_HAVE_TLS
+#include <future>
+
+#include <fcntl.h>
+
+#include "gtest/gtest.h"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(Tls, RoundTrip) {
+  TlsContext server = TlsContext::self_signed("localhost");
+  TlsContext client = TlsContext::client("", false);
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(Address("127.0.0.1", PORT));
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::future<void> accepted = std::async([&] { server.handshake(*out); });
+  try {
+    client.handshake(in, "localhost");
+    accepted.get();
+  } catch (const std::system_error& e) {
+    // Reaching the offload means the handshake itself succeeded.
+    ASSERT_EQ(ENOPROTOOPT, e.code().value());
+    ASSERT_FALSE(TlsContext::kernel_supported());
+    GTEST_SKIP() << "kernel TLS is not available";
+  }
+  uint32_t message = 42;
+  out->write(&message, sizeof(uint32_t));
+  message = 0;
+  in.read(&message, sizeof(uint32_t));
+  EXPECT_EQ(42, message);
+  in.write(&message, sizeof(uint32_t));
+  message = 0;
+  EXPECT_TRUE(out->read(&message, sizeof(uint32_t), 1000));
+  EXPECT_EQ(42, message);
+  std::string path = "/tmp/socket-test-tls-" + std::to_string(getpid());
+  std::string content(100000, 'x');
+  {
+    FileDescriptor file(open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600));
+    ASSERT_EQ((ssize_t) content.size(), ::write(file.get(), content.data(), content.size()));
+    out->send_file(file.get(), 0, content.size());
+  }
+  unlink(path.c_str());
+  std::string received(content.size(), '\0');
+  in.read(&received[0], received.size());
+  EXPECT_EQ(content, received);
+}
+
+TEST(Tls, NotTls) {
+  TlsContext client = TlsContext::client("", false);
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(Address("127.0.0.1", PORT));
+  std::unique_ptr<Bidirectional> out = outF.get();
+  std::string garbage(64, 'x');
+  out->write(garbage.data(), garbage.size());
+  try {
+    client.handshake(in);
+    ADD_FAILURE() << "handshake succeeded";
+  } catch (const std::system_error& e) {
+    ADD_FAILURE() << "expected a TLS error, got " << e.what();
+  } catch (const std::runtime_error& e) {
+  }
+}
+
+} // namespace socket
+} // namespace wrapper
+#endif
@@ -0,0 +1,96 @@
+#include <future>
+
+#include "gtest/gtest.h"
+#include "socket/write_buffer.hpp"
+
+#define PORT 8888
+
+namespace wrapper {
+namespace socket {
+
+TEST(WriteBuffer, Direct) {
+  Reactor r;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  WriteBuffer w(r, *out);
+  r.add(*out, Reactor::Handlers{nullptr, [&w] (void) { w.flush(); }, nullptr});
+  uint32_t message = 42;
+  EXPECT_TRUE(w.write(&message, sizeof(uint32_t)));
+  EXPECT_EQ(0, w.pending());
+  message = 0;
+  in.read(&message, sizeof(uint32_t));
+  EXPECT_EQ(42, message);
+  r.remove(*out);
+}
+
+TEST(WriteBuffer, EdgeTriggered) {
+  Reactor r;
+  Listening s(PORT);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Bidirectional in(s.get_address());
+  std::unique_ptr<Bidirectional> out = outF.get();
+  WriteBuffer w(r, *out, WriteWatermarks(), EPOLLIN, true);
+  int readable = 0;
+  r.add(*out, Reactor::Handlers{[&readable] (void) { readable++; }, [&w] (void) { w.flush(); },
+        nullptr}, EPOLLIN, true);
+  uint32_t message = 42;
+  in.write(&message, sizeof(uint32_t));
+  w.set_interest(EPOLLIN | EPOLLRDHUP);
+  r.poll(1000);
+  EXPECT_EQ(1, readable);
+  r.poll(10); // the data is still unread, so only a level-triggered socket reports it again
+  EXPECT_EQ(1, readable);
+  r.remove(*out);
+}
+
+// The peer stops reading, so writes queue up past the high watermark without blocking, then
+// drain through the reactor once the peer reads again.
+TEST(WriteBuffer, Backpressure) {
+  SocketOptions options;
+  options.send_buffer = 4096;
+  options.receive_buffer = 4096;
+  Reactor r;
+  Listening s(PORT, options);
+  std::future<std::unique_ptr<Bidirectional>> outF = std::async(&Listening::accept, &s, -1);
+  Connected in(s.get_address(), options);
+  std::unique_ptr<Bidirectional> out = outF.get();
+  int high = 0, low = 0;
+  WriteWatermarks watermarks;
+  watermarks.high = 65536;
+  watermarks.low = 16384;
+  watermarks.on_high = [&high] (void) { high++; };
+  watermarks.on_low = [&low] (void) { low++; };
+  WriteBuffer w(r, *out, watermarks);
+  r.add(*out, Reactor::Handlers{nullptr, [&w] (void) { w.flush(); }, nullptr});
+  std::vector<uint32_t> sent;
+  uint32_t i = 0;
+  while (true) {
+    sent.push_back(i++);
+    if (!w.write(&sent.back(), sizeof(uint32_t)))
+      break;
+  }
+  EXPECT_EQ(1, high);
+  EXPECT_EQ(0, low);
+  EXPECT_GE(w.pending(), watermarks.high);
+  EXPECT_FALSE(w.write(&i, sizeof(uint32_t))); // still queued, and still above the watermark
+  sent.push_back(i);
+  EXPECT_EQ(1, high);
+  std::future<void> readF = std::async(std::launch::async, [&in, &sent] (void) {
+        for (uint32_t expected : sent) {
+          uint32_t message;
+          in.read(&message, sizeof(uint32_t));
+          EXPECT_EQ(expected, message);
+        }
+      });
+  while (w.pending() > 0)
+    r.poll(1000);
+  readF.get();
+  EXPECT_EQ(1, low);
+  EXPECT_TRUE(w.write(&i, sizeof(uint32_t)));
+  r.remove(*out);
+}
+
+} // namespace socket
+} // namespace wrapper